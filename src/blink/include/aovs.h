@@ -14,6 +14,59 @@
 #define NORMAL_AOV 3
 #define DEPTH_AOV 4
 #define STATS_AOV 5
+#define GUIDING_AOV 6
+#define NOISE_VOLUME_AOV 7
+#define CONVERGENCE_AOV 8
+#define MOMENTS_AOV 9
+#define ALBEDO_AOV 10
+#define AOV_LAYERS_AOV 11
+#define CRYPTOMATTE_AOV 12
+
+// The most objects a pixel of the cryptomatte can keep the coverage of
+#define MAX_CRYPTOMATTE_IDS 8
+
+
+/**
+ * Get the AOV rendered into a layer of the 'AOV layers' AOV. The beauty
+ * comes first, and the stats last, so that narrowing the format to six
+ * layers leaves out the only other layer that traces whole paths.
+ *
+ * @arg layer: The index of the layer.
+ *
+ * @returns: The AOV type, or -1 if there is no such layer.
+ */
+inline int aovLayerType(const int layer)
+{
+    if (layer == 0)
+    {
+        return BEAUTY_AOV;
+    }
+    if (layer == 1)
+    {
+        return WORLD_POSITION_AOV;
+    }
+    if (layer == 2)
+    {
+        return LOCAL_POSITION_AOV;
+    }
+    if (layer == 3)
+    {
+        return NORMAL_AOV;
+    }
+    if (layer == 4)
+    {
+        return DEPTH_AOV;
+    }
+    if (layer == 5)
+    {
+        return ALBEDO_AOV;
+    }
+    if (layer == 6)
+    {
+        return STATS_AOV;
+    }
+    return -1;
+}
 
 
 /**
@@ -24,6 +77,7 @@
  * @arg localPosition: The local position at the time of exit.
  * @arg normal: The surface normal at the time of exit.
  * @arg depth: The depth at the time of exit.
+ * @arg albedo: The diffuse colour of the surface at the time of exit.
  * @arg objectId: The object ID that was last hit.
  *
  * @returns: The pixel colour for the AOV.
@@ -34,6 +88,7 @@ inline float4 earlyExitAOVs(
         const float3 &localPosition,
         const float3 &normal,
         const float depth,
+        const float3 &albedo,
         const float objectId)
 {
     if (aovType == WORLD_POSITION_AOV)
@@ -48,6 +103,14 @@ inline float4 earlyExitAOVs(
     {
         return float4(normal.x, normal.y, normal.z, objectId);
     }
+    if (aovType == ALBEDO_AOV)
+    {
+        return float4(albedo.x, albedo.y, albedo.z, objectId);
+    }
+    if (aovType == CRYPTOMATTE_AOV)
+    {
+        return float4(0, 0, 0, objectId);
+    }
     return float4(depth, 0, 0, objectId);
 }
 
@@ -102,3 +165,156 @@ inline float4 rayMissAOVs(
     }
     return float4(0);
 }
+
+
+/**
+ * Get the cryptomatte ID of an object. It is the 32-bit MurmurHash3 of
+ * the object ID, with the bits reinterpreted as a float, and with the
+ * exponent nudged off of the values that would make it a denormal,
+ * infinite, or nan, as the cryptomatte specification asks (Friedman and
+ * Jones 2015).
+ *
+ * @arg objectId: The object ID, greater than 0.
+ *
+ * @returns: The cryptomatte ID.
+ */
+inline float cryptomatteId(const float objectId)
+{
+    uint hash = murmurHash3(uint(objectId));
+
+    const uint exponent = (hash >> uint(23)) & uint(255);
+    if (exponent == uint(0) || exponent == uint(255))
+    {
+        hash ^= uint(1) << uint(23);
+    }
+
+    return uintToFloat(hash);
+}
+
+
+/**
+ * Count a path towards the coverage of the object it first hit. Once
+ * the pixel holds the maximum number of objects, a new object replaces
+ * the one with the lowest count and inherits that count, as in the
+ * space-saving algorithm, so the objects that cover the most of the
+ * pixel are kept whatever order the paths hit them in. The inherited
+ * count is remembered so it can be taken off again.
+ *
+ * @arg objectId: The ID of the object the path first hit, 0 if it
+ *     missed everything.
+ * @arg objectIds: The IDs of the objects seen by the pixel so far.
+ * @arg coverages: The number of paths counted for each of the objects,
+ *     including the count they inherited.
+ * @arg overcounts: The count each of the objects inherited.
+ * @arg numObjects: The number of objects seen by the pixel so far,
+ *     which will be incremented if the object is new.
+ */
+inline void addCryptomatteSample(
+        const float objectId,
+        float objectIds[MAX_CRYPTOMATTE_IDS],
+        float coverages[MAX_CRYPTOMATTE_IDS],
+        float overcounts[MAX_CRYPTOMATTE_IDS],
+        int &numObjects)
+{
+    if (objectId <= 0.0f)
+    {
+        return;
+    }
+
+    int lowest = 0;
+    for (int index=0; index < numObjects; index++)
+    {
+        if (objectIds[index] == objectId)
+        {
+            coverages[index] += 1.0f;
+            return;
+        }
+        if (coverages[index] < coverages[lowest])
+        {
+            lowest = index;
+        }
+    }
+
+    if (numObjects < MAX_CRYPTOMATTE_IDS)
+    {
+        objectIds[numObjects] = objectId;
+        coverages[numObjects] = 1.0f;
+        overcounts[numObjects] = 0.0f;
+        numObjects++;
+        return;
+    }
+
+    objectIds[lowest] = objectId;
+    overcounts[lowest] = coverages[lowest];
+    coverages[lowest] += 1.0f;
+}
+
+
+/**
+ * Get two of the ranks of a cryptomatte pixel, the objects are ranked
+ * by their coverage, highest first.
+ *
+ * @arg layer: The cryptomatte layer, which holds the ranks 2 * layer,
+ *     and 2 * layer + 1.
+ * @arg numPaths: The number of paths traced for the pixel.
+ * @arg objectIds: The IDs of the objects seen by the pixel, which will
+ *     be partially sorted.
+ * @arg coverages: The number of paths counted for each of the objects,
+ *     which will be sorted alongside the IDs.
+ * @arg overcounts: The count each of the objects inherited, which will
+ *     be sorted alongside the IDs.
+ * @arg numObjects: The number of objects seen by the pixel.
+ *
+ * @returns: The cryptomatte ID and coverage of the first rank in the x
+ *     and y channels, and of the second rank in the z and w channels.
+ */
+inline float4 cryptomatteRanks(
+        const int layer,
+        const float numPaths,
+        float objectIds[MAX_CRYPTOMATTE_IDS],
+        float coverages[MAX_CRYPTOMATTE_IDS],
+        float overcounts[MAX_CRYPTOMATTE_IDS],
+        const int numObjects)
+{
+    const int firstRank = 2 * layer;
+    const int lastRank = min(firstRank + 2, numObjects);
+
+    // Only the ranks up to this layer need to be in order
+    for (int rank=0; rank < lastRank; rank++)
+    {
+        int highest = rank;
+        for (int index=rank + 1; index < numObjects; index++)
+        {
+            if (coverages[index] > coverages[highest])
+            {
+                highest = index;
+            }
+        }
+
+        const float objectId = objectIds[rank];
+        const float coverage = coverages[rank];
+        const float overcount = overcounts[rank];
+        objectIds[rank] = objectIds[highest];
+        coverages[rank] = coverages[highest];
+        overcounts[rank] = overcounts[highest];
+        objectIds[highest] = objectId;
+        coverages[highest] = coverage;
+        overcounts[highest] = overcount;
+    }
+
+    // Rank by the counts, which are never below the true ones, but only
+    // output the paths that were seen to hit the object
+
+    float4 ranks = float4(0);
+    if (firstRank < numObjects)
+    {
+        ranks.x = cryptomatteId(objectIds[firstRank]);
+        ranks.y = (coverages[firstRank] - overcounts[firstRank]) / numPaths;
+    }
+    if (firstRank + 1 < numObjects)
+    {
+        ranks.z = cryptomatteId(objectIds[firstRank + 1]);
+        ranks.w = (coverages[firstRank + 1] - overcounts[firstRank + 1]) / numPaths;
+    }
+    return ranks;
+}
@@ -74,100 +74,157 @@ float4x4 projectionMatrix(
 
 
 /**
- * Generate a ray out of a camera.
+ * Get the axis of a camera along a direction in its local space.
+ *
+ * @arg cameraWorldMatrix: The camera matrix.
+ * @arg localAxis: The direction in the local space of the camera.
+ *
+ * @returns: The normalized axis in world space.
+ */
+inline float3 cameraAxis(const float4x4 &cameraWorldMatrix, const float3 &localAxis)
+{
+    const float4 axis = matmul(
+        cameraWorldMatrix,
+        float4(localAxis.x, localAxis.y, localAxis.z, 0)
+    );
+    return normalize(float3(axis.x, axis.y, axis.z));
+}
+
+
+/**
+ * Compute the frustum of a camera, as the direction of the ray through
+ * the corner of the image, and the change in direction from one pixel
+ * to the next. The direction through a point on the image is linear in
+ * its position, so a ray can then be generated without any matrix
+ * products, and neighbouring rays differ by a single addition.
  *
  * @arg cameraWorldMatrix: The camera matrix.
  * @arg inverseProjectionMatrix: The inverse of the projection matrix.
- * @arg uvPosition: The UV position in the resulting image.
- * @arg rayOrigin: Will store the origin of the ray.
- * @arg rayDirection: Will store the direction of the ray.
+ * @arg format: The width, and height of the image.
+ * @arg cornerDirection: Will store the unnormalized direction through
+ *     the bottom left corner of the image.
+ * @arg pixelStepX: Will store the change in direction per pixel along
+ *     the x-axis.
+ * @arg pixelStepY: Will store the change in direction per pixel along
+ *     the y-axis.
  */
-void createCameraRay(
+void cameraFrustum(
         const float4x4 &cameraWorldMatrix,
         const float4x4 &inverseProjectionMatrix,
-        const float2 &uvPosition,
-        float3 &rayOrigin,
-        float3 &rayDirection)
+        const float2 &format,
+        float3 &cornerDirection,
+        float3 &pixelStepX,
+        float3 &pixelStepY)
 {
-    positionFromWorldMatrix(cameraWorldMatrix, rayOrigin);
-    float4 direction = matmul(
+    // The w component of the unprojected point is dropped, so only the
+    // xyz components need to stay linear in the uv position
+    const float4 corner = matmul(inverseProjectionMatrix, float4(-1, -1, 0, 1));
+    const float4 stepX = matmul(
+        inverseProjectionMatrix,
+        float4(2.0f / format.x, 0, 0, 0)
+    );
+    const float4 stepY = matmul(
         inverseProjectionMatrix,
-        float4(uvPosition.x, uvPosition.y, 0, 1)
+        float4(0, 2.0f / format.y, 0, 0)
     );
-    matmul(
+
+    const float4 worldCorner = matmul(
         cameraWorldMatrix,
-        float4(direction.x, direction.y, direction.z, 0),
-        direction
+        float4(corner.x, corner.y, corner.z, 0)
     );
-    rayDirection = normalize(float3(direction.x, direction.y, direction.z));
+    const float4 worldStepX = matmul(
+        cameraWorldMatrix,
+        float4(stepX.x, stepX.y, stepX.z, 0)
+    );
+    const float4 worldStepY = matmul(
+        cameraWorldMatrix,
+        float4(stepY.x, stepY.y, stepY.z, 0)
+    );
+    cornerDirection = float3(worldCorner.x, worldCorner.y, worldCorner.z);
+    pixelStepX = float3(worldStepX.x, worldStepX.y, worldStepX.z);
+    pixelStepY = float3(worldStepY.x, worldStepY.y, worldStepY.z);
 }
 
 
 /**
  * Generate a ray out of a camera.
  *
- * @arg cameraWorldMatrix: The camera matrix.
- * @arg inverseProjectionMatrix: The inverse of the projection matrix.
- * @arg uvPosition: The UV position in the resulting image.
+ * @arg cameraOrigin: The position of the camera.
+ * @arg cornerDirection: The direction through the corner of the image.
+ * @arg pixelStepX: The change in direction per pixel along the x-axis.
+ * @arg pixelStepY: The change in direction per pixel along the y-axis.
+ * @arg pixelPosition: The position in the image, in pixels.
  * @arg rayOrigin: Will store the origin of the ray.
  * @arg rayDirection: Will store the direction of the ray.
  */
 void createCameraRay(
-        const float4x4 &cameraWorldMatrix,
-        const float4x4 &inverseProjectionMatrix,
-        const float2 &uvPosition,
+        const float3 &cameraOrigin,
+        const float3 &cornerDirection,
+        const float3 &pixelStepX,
+        const float3 &pixelStepY,
+        const float2 &pixelPosition,
+        float3 &rayOrigin,
+        float3 &rayDirection)
+{
+    rayOrigin = cameraOrigin;
+    rayDirection = normalize(
+        cornerDirection
+        + pixelPosition.x * pixelStepX
+        + pixelPosition.y * pixelStepY
+    );
+}
+
+
+/**
+ * Generate a ray out of a camera.
+ *
+ * @arg cameraOrigin: The position of the camera.
+ * @arg cameraRight: The normalized right axis of the camera.
+ * @arg cameraUp: The normalized up axis of the camera.
+ * @arg cameraForward: The normalized forward axis of the camera.
+ * @arg cornerDirection: The direction through the corner of the image.
+ * @arg pixelStepX: The change in direction per pixel along the x-axis.
+ * @arg pixelStepY: The change in direction per pixel along the y-axis.
+ * @arg pixelPosition: The position in the image, in pixels.
+ * @arg aperture: The radius of the aperture.
+ * @arg focalDistance: The distance to the plane in focus.
+ * @arg lensSample: Two uniform values on the interval [0, 1] that
+ *     choose the point on the aperture.
+ * @arg rayOrigin: Will store the origin of the ray.
+ * @arg rayDirection: Will store the direction of the ray.
+ */
+void createCameraRay(
+        const float3 &cameraOrigin,
+        const float3 &cameraRight,
+        const float3 &cameraUp,
+        const float3 &cameraForward,
+        const float3 &cornerDirection,
+        const float3 &pixelStepX,
+        const float3 &pixelStepY,
+        const float2 &pixelPosition,
         const float aperture,
         const float focalDistance,
-        const float3 &seed,
+        const float2 &lensSample,
         float3 &rayOrigin,
         float3 &rayDirection)
 {
     createCameraRay(
-        cameraWorldMatrix,
-        inverseProjectionMatrix,
-        uvPosition,
+        cameraOrigin,
+        cornerDirection,
+        pixelStepX,
+        pixelStepY,
+        pixelPosition,
         rayOrigin,
         rayDirection
     );
 
-    const float4 cameraForward4 = matmul(
-        cameraWorldMatrix,
-        float4(0, 0, -1, 0)
-    );
-    const float3 cameraForward = float3(
-        cameraForward4.x,
-        cameraForward4.y,
-        cameraForward4.z
-    );
-    const float4 cameraRight4 = matmul(
-        cameraWorldMatrix,
-        float4(1, 0, 0, 0)
-    );
-    const float3 cameraRight = float3(
-        cameraRight4.x,
-        cameraRight4.y,
-        cameraRight4.z
-    );
-    const float4 cameraUp4 = matmul(
-        cameraWorldMatrix,
-        float4(0, 1, 0, 0)
-    );
-    const float3 cameraUp = float3(
-        cameraUp4.x,
-        cameraUp4.y,
-        cameraUp4.z
-    );
+    // The plane in focus faces the camera, so the pinhole ray meets it
+    // after the focal distance divided by its cosine with the forward axis
+    const float3 focalPoint = rayOrigin + (
+        focalDistance / dot(rayDirection, cameraForward)
+    ) * rayDirection;
 
-    const float3 focalPlanePoint = rayOrigin + cameraForward * focalDistance;
-    const float3 focalPlaneNormal = -cameraForward;
-
-    const float focalPointDistance = (
-        (dot(focalPlaneNormal, focalPlanePoint) - dot(rayOrigin, focalPlaneNormal))
-        / dot(rayDirection, focalPlaneNormal)
-    );
-    const float3 focalPoint = rayOrigin + focalPointDistance * rayDirection;
-
-    const float2 pointInUnitCircle = uniformPointInUnitCircle(seed);
+    const float2 pointInUnitCircle = uniformPointInUnitCircle(lensSample);
     const float2 offset = pointInUnitCircle.x * aperture * float2(
         cos(pointInUnitCircle.y),
         sin(pointInUnitCircle.y)
@@ -181,21 +238,59 @@ void createCameraRay(
 /**
  * Generate a LatLong ray out of a camera.
  *
- * @arg cameraWorldMatrix: The camera matrix.
+ * @arg cameraOrigin: The position of the camera.
+ * @arg cameraRotation: The rotation of the camera.
  * @arg uvPosition: The UV position in the resulting image.
  * @arg rayOrigin: Will store the origin of the ray.
  * @arg rayDirection: Will store the direction of the ray.
  */
 void createLatLongCameraRay(
-        const float4x4 &cameraWorldMatrix,
+        const float3 &cameraOrigin,
+        const float3x3 &cameraRotation,
         const float2 &uvPosition,
         float3 &rayOrigin,
         float3 &rayDirection)
 {
-    positionFromWorldMatrix(cameraWorldMatrix, rayOrigin);
-    rayDirection = sphericalUnitVectorToCartesion(uvPositionToAngles(uvPosition));
+    rayOrigin = cameraOrigin;
+    rayDirection = matmul(
+        cameraRotation,
+        sphericalUnitVectorToCartesion(uvPositionToAngles(uvPosition))
+    );
+}
+
 
-    float3x3 cameraRotation;
-    rotationFromWorldMatrix(cameraWorldMatrix, cameraRotation);
-    rayDirection = matmul(cameraRotation, rayDirection);
+/**
+ * Move a ray from the centre of a rig of parallel cameras to one of its
+ * views. The frustum of the view is shifted, rather than turned, so that
+ * the views line up at the zero parallax distance without keystoning.
+ *
+ * @arg cameraRight: The normalized right axis of the camera.
+ * @arg cameraForward: The normalized forward axis of the camera.
+ * @arg viewOffset: The distance from the centre of the rig to the view,
+ *     along the right axis.
+ * @arg zeroParallaxDistance: The distance along the forward axis at
+ *     which the views line up, 0 to keep the rays parallel.
+ * @arg rayOrigin: The origin of the ray, will be moved to the view.
+ * @arg rayDirection: The normalized direction of the ray, will be
+ *     turned to meet the ray of the centre at the zero parallax
+ *     distance.
+ */
+inline void offsetRayToView(
+        const float3 &cameraRight,
+        const float3 &cameraForward,
+        const float viewOffset,
+        const float zeroParallaxDistance,
+        float3 &rayOrigin,
+        float3 &rayDirection)
+{
+    rayOrigin += viewOffset * cameraRight;
+    if (zeroParallaxDistance > 0.0f)
+    {
+        rayDirection = normalize(
+            rayDirection
+            - viewOffset / zeroParallaxDistance
+            * dot(rayDirection, cameraForward)
+            * cameraRight
+        );
+    }
 }
@@ -11,6 +11,12 @@
 // maximum of 4 32-bit channels defined by blink
 //
 
+// The largest finite 16-bit float
+#define MAX_HALF 65504.0f
+
+// The smallest normal 16-bit float
+#define MIN_NORMAL_HALF 0.00006103515625f
+
 
 /**
  * Convert a float vector to an int vector.
@@ -114,6 +120,8 @@ inline float4 intToFloat(const int4 value)
 }
 
 
+// The CPU renderer has its own copies of these, in src/cpu/blink.h
+#ifndef BLINK_HOST_BIT_CASTS
 /**
  * Convert a float to a uint without changing the bit values.
  *
@@ -138,6 +146,7 @@ inline float uintToFloat(const uint uintValue)
 {
     return *(float*) &uintValue;
 }
+#endif
 
 
 /**
@@ -232,6 +241,69 @@ float2 decodeFloatsFromUint(const uint value)
 }
 
 
+/**
+ * Encodes a value and its variance as 16-bit floats in the bits of a
+ * 32-bit float, so both fit in one channel of an image.
+ *
+ * The variance is stored as the standard deviation relative to the
+ * mean, as it will be decoded. For non-negative samples that is at most
+ * the square root of the number of samples, so it stays in the range of
+ * a 16-bit float however bright the value is. When the mean is too small
+ * for that, because it is zero, or not a normal 16-bit float, or the
+ * relative deviation would overflow, the absolute standard deviation is
+ * stored instead, negated to tell the two apart. It is kept a normal,
+ * finite, 16-bit float in the high bits, so the packed float is never a
+ * denormal, which GPUs flush to zero, or a NaN. Deviations below the
+ * smallest normal 16-bit float are rounded up to it, and absolute ones
+ * above the largest are clamped to it, so that they still read as noisy.
+ *
+ * @arg mean: The value, or mean, to encode.
+ * @arg variance: The variance of the value to encode.
+ *
+ * @returns: The float with the bits of two 16-bit floats.
+ */
+inline float encodeMoments(const float mean, const float variance)
+{
+    const float deviation = sqrt(max(0.0f, variance));
+    const float storedMean = halfToFloat(floatToHalf(
+        clamp(mean, -MAX_HALF, MAX_HALF)
+    ));
+    const float absoluteMean = fabs(storedMean);
+    const bool relative = (
+        absoluteMean >= MIN_NORMAL_HALF
+        && deviation < MAX_HALF * absoluteMean
+    );
+    const float storedDeviation = clamp(
+        relative ? deviation / absoluteMean : deviation,
+        MIN_NORMAL_HALF,
+        MAX_HALF
+    );
+    return uintToFloat(encodeFloatsInUint(
+        relative ? storedDeviation : -storedDeviation,
+        storedMean
+    ));
+}
+
+
+/**
+ * Decodes a value and its variance from the bits of a 32-bit float.
+ *
+ * @arg value: The float with the bits of two 16-bit floats.
+ *
+ * @returns: The value, or mean, and its variance.
+ */
+inline float2 decodeMoments(const float value)
+{
+    const float2 decoded = decodeFloatsFromUint(floatToUint(value));
+    const float deviation = (
+        decoded.x > 0.0f
+        ? decoded.x * fabs(decoded.y)
+        : -decoded.x
+    );
+    return float2(decoded.y, deviation * deviation);
+}
+
+
 /**
  * Encodes two 32-bit uints as 16-bit uints in a 32-bit uint.
  *
@@ -0,0 +1,172 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+//
+// Functions for guiding paths with a learned distribution of incident
+// light
+//
+// The guiding statistics of a pixel are the sums of the weighted
+// directions of the first diffuse bounces in the xyz channels and the
+// sum of the weights in the w channel. Being sums, the statistics of
+// separate passes are merged by adding them together.
+//
+
+// Limit the sharpness of the lobe so that the pdf stays finite
+#define MAX_GUIDING_CONCENTRATION 1000.0f
+
+// Stop guided directions from having vanishing probabilities
+#define MIN_GUIDING_PDF 0.000001f
+
+// Mean cosine above which the lobe is treated as maximally sharp
+#define MAX_GUIDING_MEAN_COSINE 0.999f
+
+
+/**
+ * Fit a von Mises-Fisher lobe to the guiding statistics of a pixel.
+ *
+ * @arg statistics: The sum of the weighted directions in the xyz
+ *     channels and the sum of the weights in the w channel.
+ *
+ * @returns: The mean direction of the lobe in the xyz channels and
+ *     its concentration in the w channel. The concentration is zero
+ *     if there is not enough information to fit a lobe.
+ */
+inline float4 fitGuidingLobe(const float4 &statistics)
+{
+    const float3 weightedDirection = float3(
+        statistics.x,
+        statistics.y,
+        statistics.z
+    );
+    const float weightedLength = length(weightedDirection);
+    if (statistics.w <= 0.0f || weightedLength <= 0.0f)
+    {
+        return float4(0);
+    }
+
+    // Approximate the maximum likelihood concentration from the mean
+    // cosine of the samples (Banerjee et al. 2005)
+    const float meanCosine = min(
+        weightedLength / statistics.w,
+        MAX_GUIDING_MEAN_COSINE
+    );
+    const float meanCosineSquared = meanCosine * meanCosine;
+    const float concentration = min(
+        meanCosine * (3.0f - meanCosineSquared) / (1.0f - meanCosineSquared),
+        MAX_GUIDING_CONCENTRATION
+    );
+
+    const float3 meanDirection = weightedDirection / weightedLength;
+
+    return float4(
+        meanDirection.x,
+        meanDirection.y,
+        meanDirection.z,
+        concentration
+    );
+}
+
+
+/**
+ * Get the probability density of a direction under a von Mises-Fisher
+ * lobe.
+ *
+ * @arg lobe: The mean direction of the lobe in the xyz channels and
+ *     its concentration in the w channel.
+ * @arg direction: The direction to get the density of.
+ *
+ * @returns: The probability density per unit solid angle.
+ */
+inline float vonMisesFisherPDF(const float4 &lobe, const float3 &direction)
+{
+    const float concentration = lobe.w;
+
+    // Written in terms of exp(k * (cos - 1)) to avoid overflow for
+    // sharp lobes
+    return (
+        concentration
+        * exp(concentration * (dot(direction, float3(lobe.x, lobe.y, lobe.z)) - 1.0f))
+        / (2.0f * PI * (1.0f - exp(-2.0f * concentration)))
+    );
+}
+
+
+/**
+ * Sample a direction from a von Mises-Fisher lobe.
+ *
+ * https://www.mitsuba-renderer.org/~wenzel/files/vmf.pdf
+ *
+ * @arg lobe: The mean direction of the lobe in the xyz channels and
+ *     its concentration in the w channel.
+ * @arg uniforms: Two uniform random values on the interval [0, 1].
+ *
+ * @returns: A random unit vector.
+ */
+inline float3 sampleVonMisesFisher(const float4 &lobe, const float2 &uniforms)
+{
+    const float concentration = lobe.w;
+    const float uniform = uniforms.x;
+    const float angle = 2.0f * PI * uniforms.y;
+
+    const float cosTheta = 1.0f + log(max(
+        uniform + (1.0f - uniform) * exp(-2.0f * concentration),
+        MIN_GUIDING_PDF
+    )) / concentration;
+    const float sinTheta = sqrt(positivePart(1.0f - cosTheta * cosTheta));
+
+    return normalize(alignWithDirection(
+        float3(0, 0, 1),
+        float3(lobe.x, lobe.y, lobe.z),
+        float3(sinTheta * cos(angle), sinTheta * sin(angle), cosTheta)
+    ));
+}
+
+
+/**
+ * Sample a direction from a von Mises-Fisher lobe.
+ *
+ * @arg lobe: The mean direction of the lobe in the xyz channels and
+ *     its concentration in the w channel.
+ * @arg seed: The random seed.
+ *
+ * @returns: A random unit vector.
+ */
+inline float3 sampleVonMisesFisher(const float4 &lobe, const float3 &seed)
+{
+    return sampleVonMisesFisher(lobe, float2(random(seed.x), random(seed.y)));
+}
+
+
+/**
+ * Get the guiding statistics contributed by a single path.
+ *
+ * @arg guidingSample: The direction of the first diffuse bounce in
+ *     the xyz channels and the inverse of the product of its pdf and
+ *     the summed throughput after the bounce in the w channel.
+ * @arg pathRadiance: The summed colour channels of the radiance
+ *     returned by the path.
+ * @arg radianceBeforeBounce: The summed colour channels of the
+ *     radiance the path had gathered before the first diffuse bounce.
+ *
+ * @returns: The weighted direction in the xyz channels and the weight
+ *     in the w channel.
+ */
+inline float4 guidingStatistics(
+        const float4 &guidingSample,
+        const float pathRadiance,
+        const float radianceBeforeBounce)
+{
+    const float weight = positivePart(
+        (pathRadiance - radianceBeforeBounce) * guidingSample.w
+    );
+
+    return float4(
+        weight * guidingSample.x,
+        weight * guidingSample.y,
+        weight * guidingSample.z,
+        weight
+    );
+}
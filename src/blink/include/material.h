@@ -9,22 +9,32 @@
 //
 
 // Increase this if you want more than MAX_NESTED_DIELECTRICS nested
-// transmissive objects
+// transmissive objects. Each one costs every path 32 bytes of private
+// memory, twice over while a path is split, so lower it to relieve the
+// register pressure of scenes that nest fewer.
 #define MAX_NESTED_DIELECTRICS 8
 
-// Number of parameters needed for nested dielectrics
-#define NESTED_DIELECTRIC_PARAMS 9
-
-// Indices for the nested dielectrics
-#define EXTINCTION_X 0
-#define EXTINCTION_Y 1
-#define EXTINCTION_Z 2
-#define OBJECT_ID 3
-#define REFRACTIVE_INDEX 4
-#define SCATTERING_X 5
-#define SCATTERING_Y 6
-#define SCATTERING_Z 7
-#define DO_REFRACTION 8
+// Each entry of the nested dielectric stack is a single int holding
+// the ID of the object in its low bits and the priority of its medium
+// in the rest. The values the medium had where the ray entered it are
+// kept alongside in NESTED_DIELECTRIC_PARAMS floats, so that any noise,
+// trap colours, or blending at the entry point carry on inside it.
+// Reading them back from the material textures by ID would save those
+// floats, but would give every medium the plain values of its object.
+#define DIELECTRIC_ID_MASK 1048575
+#define DIELECTRIC_PRIORITY_SCALE 1048576
+
+// Number of parameters stored for the media of nested dielectrics
+#define NESTED_DIELECTRIC_PARAMS 7
+
+// Indices for the media of nested dielectrics
+#define REFRACTIVE_INDEX 0
+#define EXTINCTION_X 1
+#define EXTINCTION_Y 2
+#define EXTINCTION_Z 3
+#define SCATTERING_X 4
+#define SCATTERING_Y 5
+#define SCATTERING_Z 6
 
 #define NOISE_ENABLED 1
 #define FBM_NOISE 2
@@ -38,54 +48,202 @@
 #define INVERT_NOISE 512
 #define SCATTERING_NOISE 1024
 #define EXTINCTION_NOISE 2048
+#define HASHED_NOISE 4096
 
 
 /**
- * Get the extinction coefficient from the nested dielectric stack.
+ * Pack the ID and priority of a dielectric into an entry of the
+ * nested dielectric stack.
  *
- * @arg nestedDielectrics: The stack of dielectrics that we have
- *     entered without exiting.
+ * @arg objectId: The ID of the object.
+ * @arg priority: The priority of the object's medium.
+ *
+ * @returns: The stack entry.
+ */
+inline int dielectricEntry(const int objectId, const int priority)
+{
+    return objectId + priority * DIELECTRIC_PRIORITY_SCALE;
+}
+
+
+/**
+ * Get the object ID from an entry of the nested dielectric stack.
+ *
+ * @arg dielectric: The stack entry.
+ *
+ * @returns: The ID of the object, 0 for the medium the camera is in.
+ */
+inline int dielectricObjectId(const int dielectric)
+{
+    return dielectric & DIELECTRIC_ID_MASK;
+}
+
+
+/**
+ * Get the priority from an entry of the nested dielectric stack.
+ *
+ * @arg dielectric: The stack entry.
+ *
+ * @returns: The priority of the object's medium.
+ */
+inline int dielectricPriority(const int dielectric)
+{
+    return (dielectric - dielectricObjectId(dielectric)) / DIELECTRIC_PRIORITY_SCALE;
+}
+
+
+/**
+ * Get the extinction coefficient from the nested dielectric media.
+ *
+ * @arg nestedDielectricMedia: The media of the dielectrics in the
+ *     stack, as they were when the ray entered them.
  * @arg index: The index of the dielectric to get the extinction
  *     coefficient of.
  *
  * @returns: The extinction coefficient.
  */
 inline float4 getExtinctionCoefficient(
-        const float nestedDielectrics[MAX_NESTED_DIELECTRICS][NESTED_DIELECTRIC_PARAMS],
+        const float nestedDielectricMedia[MAX_NESTED_DIELECTRICS][NESTED_DIELECTRIC_PARAMS],
         const int index)
 {
     return float4(
-        nestedDielectrics[index][EXTINCTION_X],
-        nestedDielectrics[index][EXTINCTION_Y],
-        nestedDielectrics[index][EXTINCTION_Z],
+        nestedDielectricMedia[index][EXTINCTION_X],
+        nestedDielectricMedia[index][EXTINCTION_Y],
+        nestedDielectricMedia[index][EXTINCTION_Z],
         0
     );
 }
 
 
 /**
- * Get the scattering coefficient from the nested dielectric stack.
+ * Get the scattering coefficient from the nested dielectric media.
  *
- * @arg nestedDielectrics: The stack of dielectrics that we have
- *     entered without exiting.
+ * @arg nestedDielectricMedia: The media of the dielectrics in the
+ *     stack, as they were when the ray entered them.
  * @arg index: The index of the dielectric to get the scattering
  *     coefficient of.
  *
  * @returns: The scattering coefficient.
  */
 inline float4 getScatteringCoefficient(
-        const float nestedDielectrics[MAX_NESTED_DIELECTRICS][NESTED_DIELECTRIC_PARAMS],
+        const float nestedDielectricMedia[MAX_NESTED_DIELECTRICS][NESTED_DIELECTRIC_PARAMS],
         const int index)
 {
     return float4(
-        nestedDielectrics[index][SCATTERING_X],
-        nestedDielectrics[index][SCATTERING_Y],
-        nestedDielectrics[index][SCATTERING_Z],
+        nestedDielectricMedia[index][SCATTERING_X],
+        nestedDielectricMedia[index][SCATTERING_Y],
+        nestedDielectricMedia[index][SCATTERING_Z],
         0
     );
 }
 
 
+/**
+ * Store the medium of a dielectric in the nested dielectric media.
+ *
+ * @arg refractiveIndex: The refractive index of the medium.
+ * @arg extinctionCoefficient: The extinction coefficient of the
+ *     medium.
+ * @arg scatteringCoefficient: The scattering coefficient of the
+ *     medium.
+ * @arg index: The index of the dielectric in the stack.
+ * @arg nestedDielectricMedia: The media of the dielectrics in the
+ *     stack, as they were when the ray entered them.
+ */
+inline void setDielectricMedium(
+        const float refractiveIndex,
+        const float4 &extinctionCoefficient,
+        const float4 &scatteringCoefficient,
+        const int index,
+        float nestedDielectricMedia[MAX_NESTED_DIELECTRICS][NESTED_DIELECTRIC_PARAMS])
+{
+    nestedDielectricMedia[index][REFRACTIVE_INDEX] = refractiveIndex;
+    nestedDielectricMedia[index][EXTINCTION_X] = extinctionCoefficient.x;
+    nestedDielectricMedia[index][EXTINCTION_Y] = extinctionCoefficient.y;
+    nestedDielectricMedia[index][EXTINCTION_Z] = extinctionCoefficient.z;
+    nestedDielectricMedia[index][SCATTERING_X] = scatteringCoefficient.x;
+    nestedDielectricMedia[index][SCATTERING_Y] = scatteringCoefficient.y;
+    nestedDielectricMedia[index][SCATTERING_Z] = scatteringCoefficient.z;
+}
+
+
+/**
+ * Insert a dielectric into the nested dielectric stack below the
+ * dielectrics that take priority over it.
+ *
+ * @arg dielectric: The stack entry of the object to insert.
+ * @arg refractiveIndex: The refractive index of the object's medium.
+ * @arg extinctionCoefficient: The extinction coefficient of the
+ *     object's medium.
+ * @arg scatteringCoefficient: The scattering coefficient of the
+ *     object's medium.
+ * @arg stackIndex: The position in the stack to insert the object at.
+ * @arg nestedDielectrics: The stack of dielectrics that we have
+ *     entered without exiting.
+ * @arg nestedDielectricMedia: The media of the dielectrics in the
+ *     stack, as they were when the ray entered them.
+ * @arg numNestedDielectrics: The number of dielectrics in the
+ *     stack.
+ */
+inline void insertDielectric(
+        const int dielectric,
+        const float refractiveIndex,
+        const float4 &extinctionCoefficient,
+        const float4 &scatteringCoefficient,
+        const int stackIndex,
+        int nestedDielectrics[MAX_NESTED_DIELECTRICS],
+        float nestedDielectricMedia[MAX_NESTED_DIELECTRICS][NESTED_DIELECTRIC_PARAMS],
+        int &numNestedDielectrics)
+{
+    numNestedDielectrics++;
+    for (int index=numNestedDielectrics; index > stackIndex; index--)
+    {
+        nestedDielectrics[index] = nestedDielectrics[index - 1];
+        for (int paramIndex=0; paramIndex < NESTED_DIELECTRIC_PARAMS; paramIndex++)
+        {
+            nestedDielectricMedia[index][paramIndex] = nestedDielectricMedia[index - 1][paramIndex];
+        }
+    }
+    nestedDielectrics[stackIndex] = dielectric;
+    setDielectricMedium(
+        refractiveIndex,
+        extinctionCoefficient,
+        scatteringCoefficient,
+        stackIndex,
+        nestedDielectricMedia
+    );
+}
+
+
+/**
+ * Remove a dielectric from anywhere in the nested dielectric stack.
+ *
+ * @arg stackIndex: The position in the stack of the object to remove.
+ * @arg nestedDielectrics: The stack of dielectrics that we have
+ *     entered without exiting.
+ * @arg nestedDielectricMedia: The media of the dielectrics in the
+ *     stack, as they were when the ray entered them.
+ * @arg numNestedDielectrics: The number of dielectrics in the
+ *     stack.
+ */
+inline void removeDielectric(
+        const int stackIndex,
+        int nestedDielectrics[MAX_NESTED_DIELECTRICS],
+        float nestedDielectricMedia[MAX_NESTED_DIELECTRICS][NESTED_DIELECTRIC_PARAMS],
+        int &numNestedDielectrics)
+{
+    for (int index=stackIndex; index < numNestedDielectrics; index++)
+    {
+        nestedDielectrics[index] = nestedDielectrics[index + 1];
+        for (int paramIndex=0; paramIndex < NESTED_DIELECTRIC_PARAMS; paramIndex++)
+        {
+            nestedDielectricMedia[index][paramIndex] = nestedDielectricMedia[index + 1][paramIndex];
+        }
+    }
+    numNestedDielectrics--;
+}
+
+
 /**
  * Reflect a ray off of a surface.
  *
@@ -256,26 +414,10 @@ inline float geometryFactor(
  * @arg direction: The incoming ray direction.
  * @arg surfaceNormal: The normal to the surface at the position we
  *     are sampling the material of.
- * @arg objectId: The ID of the object whose material we are sampling.
- * @arg nestedDielectrics: The stack of dielectrics that we have
- *     entered without exiting.
- * @arg numNestedDielectrics: The number of dielectrics in the
- *     stack.
- * @arg isExiting: Whether or not we will be exiting the current
- *     material if we transmit through it.
- * @arg surfaceRefractiveIndex: The refractive index of the material.
- * @arg surfaceExtinctionCoefficient: The extinction coefficient of the
- *     material.
- * @arg surfaceScatteringCoefficient: The scattering coefficient of the
- *     material.
  * @arg incidentRefractiveIndex: The refractive index of the material
  *     the ray is currently travelling through.
  * @arg refractedRefractiveIndex: The refractive index of the material
  *     we will enter.
- * @arg refractedExtinctionCoefficient: The extinction coefficient of
- *     the material we would enter.
- * @arg refractedScatteringCoefficient: The scattering coefficient of
- *     the material we would enter.
  * @arg specularProbability: The probability that we would specularly
  *     reflect off this surface.
  * @arg refractionProbability: The probability that we would transmit
@@ -284,44 +426,11 @@ inline float geometryFactor(
 inline void getReflectivityData(
         const float3 &direction,
         const float3 &surfaceNormal,
-        const float objectId,
-        const float nestedDielectrics[MAX_NESTED_DIELECTRICS][NESTED_DIELECTRIC_PARAMS],
-        const int numNestedDielectrics,
-        const bool isExiting,
-        const float surfaceRefractiveIndex,
-        const float4 &surfaceExtinctionCoefficient,
-        const float4 &surfaceScatteringCoefficient,
-        float &incidentRefractiveIndex,
-        float &refractedRefractiveIndex,
-        float4 &refractedExtinctionCoefficient,
-        float4 &refractedScatteringCoefficient,
+        const float incidentRefractiveIndex,
+        const float refractedRefractiveIndex,
         float &specularProbability,
         float &refractionProbability)
 {
-    incidentRefractiveIndex = nestedDielectrics[numNestedDielectrics][REFRACTIVE_INDEX];
-
-    if (isExiting)
-    {
-        // We are exiting the material we are in, get the
-        // last refractive index from the top of the stack
-        refractedExtinctionCoefficient = getExtinctionCoefficient(
-            nestedDielectrics,
-            numNestedDielectrics - 1
-        );
-        refractedRefractiveIndex = nestedDielectrics[numNestedDielectrics - 1][REFRACTIVE_INDEX];
-        refractedScatteringCoefficient = getScatteringCoefficient(
-            nestedDielectrics,
-            numNestedDielectrics - 1
-        );
-    }
-    else
-    {
-        // Otherwise we will be entering a new material
-        refractedExtinctionCoefficient = surfaceExtinctionCoefficient;
-        refractedRefractiveIndex = surfaceRefractiveIndex;
-        refractedScatteringCoefficient = surfaceScatteringCoefficient;
-    }
-
     // Compute the refraction values
     const float reflectivity = schlickReflectionCoefficient(
         direction,
@@ -360,7 +469,7 @@ inline void getReflectivityData(
  * @arg specularDirection: The location to store the new ray direction.
  * @arg position: The location to store the new ray origin.
  */
-inline float specularBounce(
+inline void specularBounce(
         const float3 &incidentDirection,
         const float3 &surfaceNormal,
         const float3 &diffuseDirection,
@@ -495,13 +604,12 @@ inline void transmissiveBounce(
  * @arg refractedDirection: The direction the ray will travel.
  * @arg refractionProbability: The probability that we would transmit
  *     through this surface.
- * @arg refractedRefractiveIndex: The refractive index of the material.
- * @arg refractedExtinctionCoefficient: The extinction coefficient of
- *     the material.
- * @arg refractedScatteringCoefficient: The scattering coefficient of
- *     the material.
- * @arg objectId: The ID of the object whose material we are sampling.
- * @arg doRefraction: Whether or not refraction is enabled on the
+ * @arg dielectric: The stack entry of the object whose material we
+ *     are sampling.
+ * @arg refractiveIndex: The refractive index of the material.
+ * @arg extinctionCoefficient: The extinction coefficient of the
+ *     material.
+ * @arg scatteringCoefficient: The scattering coefficient of the
  *     material.
  * @arg isExiting: Whether or not we will be exiting the current
  *     material if we transmit through it.
@@ -511,6 +619,8 @@ inline void transmissiveBounce(
  *     perspective of the light we will be sampling.
  * @arg nestedDielectrics: The stack of dielectrics that we have
  *     entered without exiting.
+ * @arg nestedDielectricMedia: The media of the dielectrics in the
+ *     stack, as they were when the ray entered them.
  * @arg numNestedDielectrics: The number of dielectrics in the
  *     stack.
  *
@@ -520,15 +630,15 @@ inline float sampleTransmissive(
         const float3 &idealRefractedDirection,
         const float3 &refractedDirection,
         const float refractionProbability,
-        const float refractedRefractiveIndex,
-        const float4 &refractedExtinctionCoefficient,
-        const float4 &refractedScatteringCoefficient,
-        const float objectId,
-        const bool doRefraction,
+        const int dielectric,
+        const float refractiveIndex,
+        const float4 &extinctionCoefficient,
+        const float4 &scatteringCoefficient,
         const bool isExiting,
         float4 &materialBRDF,
         float &lightPDF,
-        float nestedDielectrics[MAX_NESTED_DIELECTRICS][NESTED_DIELECTRIC_PARAMS],
+        int nestedDielectrics[MAX_NESTED_DIELECTRICS],
+        float nestedDielectricMedia[MAX_NESTED_DIELECTRICS][NESTED_DIELECTRIC_PARAMS],
         int &numNestedDielectrics)
 {
     // We are passing through the surface
@@ -540,17 +650,16 @@ inline float sampleTransmissive(
     else
     {
         // We are not exiting the material we are in, we are entering
-        // a new one, so push the next refractive index to the stack
+        // a new one, so push it and its medium to the stack
         numNestedDielectrics++;
-        nestedDielectrics[numNestedDielectrics][EXTINCTION_X] = refractedExtinctionCoefficient.x;
-        nestedDielectrics[numNestedDielectrics][EXTINCTION_Y] = refractedExtinctionCoefficient.y;
-        nestedDielectrics[numNestedDielectrics][EXTINCTION_Z] = refractedExtinctionCoefficient.z;
-        nestedDielectrics[numNestedDielectrics][OBJECT_ID] = objectId;
-        nestedDielectrics[numNestedDielectrics][REFRACTIVE_INDEX] = refractedRefractiveIndex;
-        nestedDielectrics[numNestedDielectrics][SCATTERING_X] = refractedScatteringCoefficient.x;
-        nestedDielectrics[numNestedDielectrics][SCATTERING_Y] = refractedScatteringCoefficient.y;
-        nestedDielectrics[numNestedDielectrics][SCATTERING_Z] = refractedScatteringCoefficient.z;
-        nestedDielectrics[numNestedDielectrics][DO_REFRACTION] = doRefraction;
+        nestedDielectrics[numNestedDielectrics] = dielectric;
+        setDielectricMedium(
+            refractiveIndex,
+            extinctionCoefficient,
+            scatteringCoefficient,
+            numNestedDielectrics,
+            nestedDielectricMedia
+        );
     }
 
     const float probabilityOverPi = refractionProbability / PI;
@@ -626,9 +735,30 @@ inline float sampleDiffuse(
 
 
 /**
- * Perform material sampling.
+ * Get the uniform random values that material sampling uses from a
+ * seed.
  *
  * @arg seed: The seed to use in randomization.
+ *
+ * @returns: The values for the direction in the x and y channels, and
+ *     for the choice of lobe in the z channel.
+ */
+inline float3 materialSampleFromSeed(const float3 &seed)
+{
+    return float3(
+        random(seed.x),
+        random(seed.y),
+        random(random(seed.x) + random(seed.y) + random(seed.z))
+    );
+}
+
+
+/**
+ * Perform material sampling.
+ *
+ * @arg uniforms: Uniform random values on the interval [0, 1], for the
+ *     direction in the x and y channels, and for the choice of lobe in
+ *     the z channel.
  * @arg surfaceNormal: The normal to the surface at the position we
  *     are sampling the material of.
  * @arg incidentDirection: The incoming ray direction.
@@ -639,14 +769,18 @@ inline float sampleDiffuse(
  *     probability of the surface.
  * @arg doRefraction: Whether or not refraction is enabled on the
  *     material.
- * @arg surfaceRefractiveIndex: The refractive index of the material.
+ * @arg incidentRefractiveIndex: The refractive index of the material
+ *     the ray is currently travelling through.
+ * @arg refractedRefractiveIndex: The refractive index of the material
+ *     we will enter if we transmit through the surface.
  * @arg surfaceScatteringCoefficient: The scattering coefficient of the
  *     material.
  * @arg transmissionRoughness: The transmissive roughness of the
  *     surface.
  * @arg specularity: The specular values of the surface.
  * @arg specularRoughness: The specular roughness of the surface.
- * @arg objectId: The ID of the object whose material we are sampling.
+ * @arg dielectric: The stack entry of the object whose material we
+ *     are sampling.
  * @arg isExiting: Whether or not we will be exiting the current
  *     material if we transmit through it.
  * @arg materialBRDF: The BRDF of the surface at the position we
@@ -657,6 +791,8 @@ inline float sampleDiffuse(
  *     material of.
  * @arg nestedDielectrics: The stack of dielectrics that we have
  *     entered without exiting.
+ * @arg nestedDielectricMedia: The media of the dielectrics in the
+ *     stack, as they were when the ray entered them.
  * @arg numNestedDielectrics: The number of dielectrics in the
  *     stack.
  * @arg lightPDF: The PDF of the material we are sampling from the
@@ -665,39 +801,37 @@ inline float sampleDiffuse(
  * @returns: The material PDF.
  */
 inline float sampleMaterial(
-        const float3 &seed,
+        const float3 &uniforms,
         const float3 &surfaceNormal,
         const float3 &incidentDirection,
         const float4 &diffusivity,
         const float offset,
         const float4 &transmittance,
         const bool doRefraction,
-        const float surfaceRefractiveIndex,
+        const float incidentRefractiveIndex,
+        const float refractedRefractiveIndex,
         const float4 &surfaceScatteringCoefficient,
         const float transmissionRoughness,
         const float4 &specularity,
         const float specularRoughness,
-        const float objectId,
+        const int dielectric,
         const bool isExiting,
         float4 &materialBRDF,
         float3 &outgoingDirection,
         float3 &position,
-        float nestedDielectrics[MAX_NESTED_DIELECTRICS][NESTED_DIELECTRIC_PARAMS],
+        int nestedDielectrics[MAX_NESTED_DIELECTRICS],
+        float nestedDielectricMedia[MAX_NESTED_DIELECTRICS][NESTED_DIELECTRIC_PARAMS],
         int &numNestedDielectrics,
         float &lightPDF)
 {
     // Get the diffuse direction for the next ray
     const float3 diffuseDirection = cosineDirectionInHemisphere(
         surfaceNormal,
-        seed
+        float2(uniforms.x, uniforms.y)
     );
 
-    const float rng = random(random(seed.x) + random(seed.y) + random(seed.z));
+    const float rng = uniforms.z;
 
-    float incidentRefractiveIndex;
-    float refractedRefractiveIndex;
-    float4 refractedScatteringCoefficient;
-    float4 refractedExtinctionCoefficient;
     float specularProbability = specularity.w;
     float refractionProbability = transmittance.w;
 
@@ -706,17 +840,8 @@ inline float sampleMaterial(
         getReflectivityData(
             incidentDirection,
             surfaceNormal,
-            objectId,
-            nestedDielectrics,
-            numNestedDielectrics,
-            isExiting,
-            surfaceRefractiveIndex,
-            transmittance,
-            surfaceScatteringCoefficient,
             incidentRefractiveIndex,
             refractedRefractiveIndex,
-            refractedExtinctionCoefficient,
-            refractedScatteringCoefficient,
             specularProbability,
             refractionProbability
         );
@@ -779,15 +904,15 @@ inline float sampleMaterial(
             idealRefractedDirection,
             outgoingDirection,
             refractionProbability,
+            dielectric,
             refractedRefractiveIndex,
-            refractedExtinctionCoefficient,
-            refractedScatteringCoefficient,
-            objectId,
-            doRefraction,
+            transmittance,
+            surfaceScatteringCoefficient,
             isExiting,
             materialBRDF,
             lightPDF,
             nestedDielectrics,
+            nestedDielectricMedia,
             numNestedDielectrics
         );
     }
@@ -11,6 +11,10 @@
 #define PI_BY_TWO (PI / 2.0f)
 #define TWO_PI (2.0f * PI)
 
+// The radiance below which the error of a pixel is measured absolutely
+// rather than relative to its value
+#define MIN_CONVERGENCE_RADIANCE 0.01f
+
 
 /**
  * Convert degrees to radians.
@@ -1241,6 +1245,59 @@ inline float adaptiveSamples(
 }
 
 
+/**
+ * Compute the number of samples we should use between a min and max.
+ *
+ * @arg minSamples: The minimum samples.
+ * @arg maxSamples: The maximum samples.
+ * @arg relativeError: The relative error of the samples taken so far,
+ *     which weights the number of samples.
+ *
+ * @returns: The number of samples to take.
+ */
+inline float adaptiveSamples(
+        const float minSamples,
+        const float maxSamples,
+        const float relativeError)
+{
+    return clamp(
+        round(maxSamples * relativeError),
+        minSamples,
+        maxSamples
+    );
+}
+
+
+/**
+ * Compute the relative standard error of the mean of a set of samples.
+ *
+ * @arg mean: The mean of the samples.
+ * @arg sumOfSquares: The sum of the squared deviations of the samples
+ *     from their mean.
+ * @arg numSamples: The number of samples.
+ *
+ * @returns: The standard error of the summed channels of the mean,
+ *     relative to the summed channels of the mean.
+ */
+inline float relativeStandardError(
+        const float3 &mean,
+        const float3 &sumOfSquares,
+        const float numSamples)
+{
+    if (numSamples < 2.0f)
+    {
+        // Nothing is known about the error of a single sample
+        return 1.0f;
+    }
+
+    const float varianceOfMean = sumComponent(sumOfSquares) / (
+        numSamples * (numSamples - 1.0f)
+    );
+
+    return sqrt(varianceOfMean) / max(sumComponent(mean), MIN_CONVERGENCE_RADIANCE);
+}
+
+
 /**
  * Combine two PDFs in an optimal manner.
  *
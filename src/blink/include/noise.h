@@ -522,6 +522,154 @@ inline float perlinSimplexNoise(
 }
 
 
+/**
+ * Get one of the 32 gradients of 4D simplex noise from a hash, without
+ * a lookup table. The gradients are the midpoints of the edges of a 4D
+ * hypercube, in the same order as the grad4 LUT.
+ *
+ * @arg hash: Hash value.
+ *
+ * @returns: The gradient.
+ */
+inline float4 hashedGradient(const int hash)
+{
+    const int h = hash & 31;
+
+    // The lower three bits are the signs of the non-zero components
+    const float a = float(1 - ((h >> 1) & 2));
+    const float b = float(1 - (h & 2));
+    const float c = float(1 - ((h << 1) & 2));
+
+    // The upper two bits choose the component that is zero, the signs
+    // fill the other components in order. Masking rather than
+    // branching keeps neighbouring pixels from diverging.
+    const int zeroComponent = h >> 3;
+    return float4(
+        float(zeroComponent != 0) * a,
+        float(zeroComponent == 0) * a + float(zeroComponent >= 2) * b,
+        float(zeroComponent <= 1) * b + float(zeroComponent == 3) * c,
+        float(zeroComponent != 3) * c
+    );
+}
+
+
+/**
+ * Hash the coordinates of a 4D lattice point. The coordinates are
+ * mixed with large odd multipliers so that a single Wang hash is
+ * enough to decorrelate neighbouring points.
+ *
+ * @arg i: The x coordinate of the lattice point.
+ * @arg j: The y coordinate of the lattice point.
+ * @arg k: The z coordinate of the lattice point.
+ * @arg l: The w coordinate of the lattice point.
+ *
+ * @returns: The hashed value.
+ */
+inline int latticeHash(const int i, const int j, const int k, const int l)
+{
+    return wangHash(
+        (i * 73856093) ^ (j * 19349663) ^ (k * 83492791) ^ (l * 50331653)
+    );
+}
+
+
+/**
+ * Get the contribution of one corner of a 4D simplex.
+ *
+ * @arg offset: The offset of the seed from the corner.
+ * @arg gradient: The gradient at the corner.
+ *
+ * @returns: The contribution of the corner.
+ */
+inline float simplexCornerContribution(
+        const float4 &offset,
+        const float4 &gradient)
+{
+    // Clamp rather than branch, so that SIMD lanes evaluating different
+    // positions or octaves never diverge
+    float t = max(0.6f - dot(offset, offset), 0.0f);
+    t *= t;
+    return t * t * dot(gradient, offset);
+}
+
+
+/**
+ * 4D Perlin simplex noise without lookup tables. The corners of the
+ * simplex are found by ranking the components of the offset from the
+ * cell origin, and the gradients are chosen with nested Wang hashes of
+ * the lattice coordinates. Unlike the LUT version, the noise does not
+ * repeat every 256 units.
+ *
+ * @arg seed: The seed for the noise.
+ *
+ * @returns: Noise value in the range [-1, 1], value of 0 on all integer
+ *     coordinates.
+ */
+inline float perlinSimplexNoise(const float4 &seed)
+{
+    const float F4 = (sqrt(5.0f) - 1.0f) / 4.0f;
+    const float G4 = (5.0f - sqrt(5.0f)) / 20.0f;
+
+    // Skew the input space to determine which simplex cell we're in
+    const float s = sumComponent(seed) * F4;
+    const int i = floor(seed.x + s);
+    const int j = floor(seed.y + s);
+    const int k = floor(seed.z + s);
+    const int l = floor(seed.w + s);
+
+    // Unskew the cell origin back to (x,y,z,w) space
+    const float t = (i + j + k + l) * G4;
+    const float4 offset0 = seed - float4(i - t, j - t, k - t, l - t);
+
+    // Rank the components of the offset by comparing each pair, the
+    // largest component is stepped along first
+    const int xy = offset0.x > offset0.y ? 1 : 0;
+    const int xz = offset0.x > offset0.z ? 1 : 0;
+    const int xw = offset0.x > offset0.w ? 1 : 0;
+    const int yz = offset0.y > offset0.z ? 1 : 0;
+    const int yw = offset0.y > offset0.w ? 1 : 0;
+    const int zw = offset0.z > offset0.w ? 1 : 0;
+    const int rankX = xy + xz + xw;
+    const int rankY = 1 - xy + yz + yw;
+    const int rankZ = 2 - xz - yz + zw;
+    const int rankW = 3 - xw - yw - zw;
+
+    const int i1 = rankX >= 3 ? 1 : 0;
+    const int j1 = rankY >= 3 ? 1 : 0;
+    const int k1 = rankZ >= 3 ? 1 : 0;
+    const int l1 = rankW >= 3 ? 1 : 0;
+    const int i2 = rankX >= 2 ? 1 : 0;
+    const int j2 = rankY >= 2 ? 1 : 0;
+    const int k2 = rankZ >= 2 ? 1 : 0;
+    const int l2 = rankW >= 2 ? 1 : 0;
+    const int i3 = rankX >= 1 ? 1 : 0;
+    const int j3 = rankY >= 1 ? 1 : 0;
+    const int k3 = rankZ >= 1 ? 1 : 0;
+    const int l3 = rankW >= 1 ? 1 : 0;
+
+    // Offsets of the remaining corners in unskewed coords
+    const float4 offset1 = offset0 - float4(i1, j1, k1, l1) + G4;
+    const float4 offset2 = offset0 - float4(i2, j2, k2, l2) + 2.0f * G4;
+    const float4 offset3 = offset0 - float4(i3, j3, k3, l3) + 3.0f * G4;
+    const float4 offset4 = offset0 - 1.0f + 4.0f * G4;
+
+    // Work out the hashed gradient indices of the five simplex corners
+    const int gi0 = latticeHash(i, j, k, l);
+    const int gi1 = latticeHash(i + i1, j + j1, k + k1, l + l1);
+    const int gi2 = latticeHash(i + i2, j + j2, k + k2, l + l2);
+    const int gi3 = latticeHash(i + i3, j + j3, k + k3, l + l3);
+    const int gi4 = latticeHash(i + 1, j + 1, k + 1, l + 1);
+
+    return 27.0f * (
+        simplexCornerContribution(offset0, hashedGradient(gi0))
+        + simplexCornerContribution(offset1, hashedGradient(gi1))
+        + simplexCornerContribution(offset2, hashedGradient(gi2))
+        + simplexCornerContribution(offset3, hashedGradient(gi3))
+        + simplexCornerContribution(offset4, hashedGradient(gi4))
+    );
+}
+
+
 // Copyright 2022 by Owen Bulka.
 // All rights reserved.
 // This file is released under the "MIT License Agreement".
@@ -532,6 +680,28 @@ inline float perlinSimplexNoise(
 // Use the perlin simplex noise
 //
 
+// The mean absolute value of the simplex noise, which stands in for
+// the turbulence octaves that are too fine to resolve
+#define SIMPLEX_NOISE_ABSOLUTE_MEAN 0.226f
+
+
+/**
+ * Get how much of an octave of noise to keep when it is filtered over
+ * a footprint. The octave fades out as its features shrink from four
+ * to two per footprint, as beyond the Nyquist limit they would only
+ * alias.
+ *
+ * @arg frequency: The frequency of the octave, in lattice cells per
+ *     unit of the position.
+ * @arg filterWidth: The width of the footprint, 0 keeps every octave.
+ *
+ * @returns: The weight of the octave in the range [0, 1].
+ */
+inline float octaveFilterWeight(const float frequency, const float filterWidth)
+{
+    return saturate(2.0f - 4.0f * frequency * filterWidth);
+}
+
 
 /**
  * fBM noise.
@@ -675,6 +845,9 @@ float fractalBrownianMotionNoise(
  * @arg simplex: The simplex LUT.
  * @arg perm: The perm LUT.
  * @arg grad4: The grad4 LUT.
+ * @arg filterWidth: The width of the footprint to filter the noise
+ *     over, octaves that are too fine to resolve are replaced by their
+ *     mean.
  *
  * @returns: The noise value in the range [-1, 1].
  */
@@ -691,7 +864,8 @@ float fractalBrownianMotionNoise(
         const float4 &highFrequencyTranslation,
         const int simplex[64][4],
         const int perm[512],
-        const int grad4[32][4])
+        const int grad4[32][4],
+        const float filterWidth)
 {
     float output = 0.0f;
     float frequency = lacunarity;
@@ -711,19 +885,123 @@ float fractalBrownianMotionNoise(
             (highFrequencyTranslation * octaveFraction)
             + (lowFrequencyTranslation * (1 - octaveFraction))
         );
+        const float filterWeight = octaveFilterWeight(
+            frequency * maxComponent(fabs(float3(scale.x, scale.y, scale.z))) / size,
+            filterWidth
+        );
+
+        // The culled part of the octave is replaced by its mean of 0
+        if (filterWeight > 0.0f)
+        {
+            output += filterWeight * amplitude * perlinSimplexNoise(
+                (position * scale + translation) * frequency / size,
+                simplex,
+                perm,
+                grad4
+            );
+        }
+
+        frequency *= lacunarity;
+        denom += amplitude;
+        amplitude *= gain;
+    }
+
+    if (denom == 0.0f || gamma == 0.0f)
+    {
+        return 1.0f;
+    }
+    return pow(output / denom, 1.0f / gamma);
+}
+
+
+/**
+ * fBM noise using the table free simplex noise.
+ *
+ * @arg octaves: The number of different frequencies to use.
+ * @arg lacunarity: The per octave frequency multiplier.
+ * @arg size: The size of the noise.
+ * @arg gain: The per octave amplitude multiplier.
+ * @arg gamma: The result will be raised to 1 over this power.
+ * @arg position: The position to seed the noise.
+ * @arg lowFrequencyScale: The amount to scale the lower frequencies by.
+ * @arg highFrequencyScale: The amount to scale the higher frequencies by.
+ * @arg lowFrequencyTranslation: The translation of the lower frequencies.
+ * @arg highFrequencyTranslation: The translation of the higher frequencies.
+ * @arg filterWidth: The width of the footprint to filter the noise
+ *     over, octaves that are too fine to resolve are replaced by their
+ *     mean.
+ *
+ * @returns: The noise value in the range [-1, 1].
+ */
+float fractalBrownianMotionNoise(
+        const float octaves,
+        const float lacunarity,
+        const float size,
+        const float gain,
+        const float gamma,
+        const float4 &position,
+        const float4 &lowFrequencyScale,
+        const float4 &highFrequencyScale,
+        const float4 &lowFrequencyTranslation,
+        const float4 &highFrequencyTranslation,
+        const float filterWidth)
+{
+    float output = 0.0f;
+    float frequency = lacunarity;
+    float amplitude = 1.0f;
+    float denom = 0.0f;
+    float4 translation;
+    float4 scale;
+
+#ifdef BLINK_HOST_SIMD_NOISE
+    // On the CPU the octaves are evaluated together, see
+    // 'src/cpu/simd_noise.h'
+    SimdNoiseSum noiseSum;
+#endif
 
-        output += amplitude * perlinSimplexNoise(
-            (position * scale + translation) * frequency / size,
-            simplex,
-            perm,
-            grad4
+    for (int octave=0; octave < octaves; octave++)
+    {
+        const float octaveFraction = octave / octaves;
+        scale = (
+            (highFrequencyScale * octaveFraction)
+            + (lowFrequencyScale * (1 - octaveFraction))
+        );
+        translation = (
+            (highFrequencyTranslation * octaveFraction)
+            + (lowFrequencyTranslation * (1 - octaveFraction))
+        );
+        const float filterWeight = octaveFilterWeight(
+            frequency * maxComponent(fabs(float3(scale.x, scale.y, scale.z))) / size,
+            filterWidth
         );
 
+        // The culled part of the octave is replaced by its mean of 0
+        if (filterWeight > 0.0f)
+        {
+            const float4 seed = (position * scale + translation) * frequency / size;
+#ifdef BLINK_HOST_SIMD_NOISE
+            if (simdNoiseEnabled())
+            {
+                noiseSum.add(seed, filterWeight * amplitude);
+            }
+            else
+            {
+                output += filterWeight * amplitude * perlinSimplexNoise(seed);
+            }
+#else
+            output += filterWeight * amplitude * perlinSimplexNoise(seed);
+#endif
+        }
+
         frequency *= lacunarity;
         denom += amplitude;
         amplitude *= gain;
     }
 
+#ifdef BLINK_HOST_SIMD_NOISE
+    output += noiseSum.sum();
+#endif
+
     if (denom == 0.0f || gamma == 0.0f)
     {
         return 1.0f;
@@ -874,6 +1152,9 @@ float turbulenceNoise(
  * @arg simplex: The simplex LUT.
  * @arg perm: The perm LUT.
  * @arg grad4: The grad4 LUT.
+ * @arg filterWidth: The width of the footprint to filter the noise
+ *     over, octaves that are too fine to resolve are replaced by their
+ *     mean.
  *
  * @returns: The noise value in the range [0, 1].
  */
@@ -890,7 +1171,8 @@ float turbulenceNoise(
         const float4 &highFrequencyTranslation,
         const int simplex[64][4],
         const int perm[512],
-        const int grad4[32][4])
+        const int grad4[32][4],
+        const float filterWidth)
 {
     float output = 0.0f;
     float frequency = lacunarity;
@@ -910,16 +1192,104 @@ float turbulenceNoise(
             (highFrequencyTranslation * octaveFraction)
             + (lowFrequencyTranslation * (1 - octaveFraction))
         );
+        const float filterWeight = octaveFilterWeight(
+            frequency * maxComponent(fabs(float3(scale.x, scale.y, scale.z))) / size,
+            filterWidth
+        );
 
-        output += fabs(
-            amplitude * perlinSimplexNoise(
-                (position * scale + translation) * frequency / size,
-                simplex,
-                perm,
-                grad4
-            )
+        float octaveValue = SIMPLEX_NOISE_ABSOLUTE_MEAN;
+        if (filterWeight > 0.0f)
+        {
+            octaveValue = filterWeight * fabs(
+                perlinSimplexNoise(
+                    (position * scale + translation) * frequency / size,
+                    simplex,
+                    perm,
+                    grad4
+                )
+            ) + (1.0f - filterWeight) * SIMPLEX_NOISE_ABSOLUTE_MEAN;
+        }
+        output += fabs(amplitude) * octaveValue;
+
+        frequency *= lacunarity;
+        denom += amplitude;
+        amplitude *= gain;
+    }
+
+    if (denom == 0.0f || gamma == 0.0f)
+    {
+        return 1.0f;
+    }
+    return pow(output / denom, 1.0f / gamma);
+}
+
+
+/**
+ * Turbulence noise using the table free simplex noise.
+ *
+ * @arg octaves: The number of different frequencies to use.
+ * @arg lacunarity: The per octave frequency multiplier.
+ * @arg size: The size of the noise.
+ * @arg gain: The per octave amplitude multiplier.
+ * @arg gamma: The result will be raised to 1 over this power.
+ * @arg position: The position to seed the noise.
+ * @arg lowFrequencyScale: The amount to scale the lower frequencies by.
+ * @arg highFrequencyScale: The amount to scale the higher frequencies by.
+ * @arg lowFrequencyTranslation: The translation of the lower frequencies.
+ * @arg highFrequencyTranslation: The translation of the higher frequencies.
+ * @arg filterWidth: The width of the footprint to filter the noise
+ *     over, octaves that are too fine to resolve are replaced by their
+ *     mean.
+ *
+ * @returns: The noise value in the range [0, 1].
+ */
+float turbulenceNoise(
+        const float octaves,
+        const float lacunarity,
+        const float size,
+        const float gain,
+        const float gamma,
+        const float4 &position,
+        const float4 &lowFrequencyScale,
+        const float4 &highFrequencyScale,
+        const float4 &lowFrequencyTranslation,
+        const float4 &highFrequencyTranslation,
+        const float filterWidth)
+{
+    float output = 0.0f;
+    float frequency = lacunarity;
+    float amplitude = 1.0f;
+    float denom = 0.0f;
+    float4 translation;
+    float4 scale;
+
+    for (int octave=0; octave < octaves; octave++)
+    {
+        const float octaveFraction = octave / octaves;
+        scale = (
+            (highFrequencyScale * octaveFraction)
+            + (lowFrequencyScale * (1 - octaveFraction))
+        );
+        translation = (
+            (highFrequencyTranslation * octaveFraction)
+            + (lowFrequencyTranslation * (1 - octaveFraction))
+        );
+        const float filterWeight = octaveFilterWeight(
+            frequency * maxComponent(fabs(float3(scale.x, scale.y, scale.z))) / size,
+            filterWidth
         );
 
+        float octaveValue = SIMPLEX_NOISE_ABSOLUTE_MEAN;
+        if (filterWeight > 0.0f)
+        {
+            octaveValue = filterWeight * fabs(
+                perlinSimplexNoise(
+                    (position * scale + translation) * frequency / size
+                )
+            ) + (1.0f - filterWeight) * SIMPLEX_NOISE_ABSOLUTE_MEAN;
+        }
+        output += fabs(amplitude) * octaveValue;
+
         frequency *= lacunarity;
         denom += amplitude;
         amplitude *= gain;
@@ -62,6 +62,73 @@ inline int wangHash(int seed)
 }
 
 
+/**
+ * Compute a PCG hash. Unlike the Wang hash, consecutive seeds give
+ * uncorrelated values, so it can index a sequence of random values.
+ *
+ * @arg seed: The seed to hash.
+ *
+ * @returns: The hashed value.
+ */
+inline uint pcgHash(uint seed)
+{
+    const uint state = seed * uint(747796405) + uint(2891336453);
+    const uint word = (
+        (state >> ((state >> uint(28)) + uint(4))) ^ state
+    ) * uint(277803737);
+    return (word >> uint(22)) ^ word;
+}
+
+
+/**
+ * Compute the 32-bit MurmurHash3 of a single 32-bit key, with a seed of
+ * zero (Appleby 2011).
+ *
+ * @arg key: The key to hash.
+ *
+ * @returns: The hashed value.
+ */
+inline uint murmurHash3(uint key)
+{
+    key *= uint(0xcc9e2d51);
+    key = (key << uint(15)) | (key >> uint(17));
+    key *= uint(0x1b873593);
+
+    uint hash = key;
+    hash = (hash << uint(13)) | (hash >> uint(19));
+    hash = hash * uint(5) + uint(0xe6546b64);
+
+    // The length of the key, in bytes
+    hash ^= uint(4);
+
+    hash ^= hash >> uint(16);
+    hash *= uint(0x85ebca6b);
+    hash ^= hash >> uint(13);
+    hash *= uint(0xc2b2ae35);
+    hash ^= hash >> uint(16);
+    return hash;
+}
+
+
+/**
+ * Hash a floating point seed into the state of a random sequence.
+ *
+ * @arg seed: The random seed.
+ *
+ * @returns: The state of the sequence.
+ */
+inline uint hashSeed(const float3 &seed)
+{
+    return pcgHash(
+        uint(8388608.0f * fract(seed.x))
+        ^ pcgHash(
+            uint(8388608.0f * fract(seed.y))
+            ^ pcgHash(uint(8388608.0f * fract(seed.z)))
+        )
+    );
+}
+
+
 /**
  * Get a random value on the interval [0, 1].
  *
@@ -88,6 +155,127 @@ inline float random(uint seed)
 }
 
 
+/**
+ * Get a value from a sequence of random values on the interval
+ * [0, 1).
+ *
+ * @arg state: The state of the sequence, from hashSeed.
+ * @arg index: The index of the value in the sequence.
+ *
+ * @returns: A random value on the interval [0, 1).
+ */
+inline float random(const uint state, const int index)
+{
+    return float(pcgHash(state + uint(index)) >> uint(8)) / 16777216.0f;
+}
+
+
+/**
+ * Get three uniform values for a pixel from the hashes of its
+ * location, the frame, and the pass, so that every pixel gets
+ * uncorrelated seeds that change between frames and passes.
+ *
+ * @arg pixel: The x, and y location of the pixel.
+ * @arg frame: The frame being rendered.
+ * @arg pass: The index of the pass, which must differ between renders
+ *     that are combined.
+ *
+ * @returns: Three random values on the interval [0, 1).
+ */
+inline float3 pixelSeedValues(const int2 &pixel, const int frame, const int pass)
+{
+    const uint state = pcgHash(
+        pcgHash(pcgHash(uint(pixel.x)) ^ uint(pixel.y))
+        ^ pcgHash(uint(frame) ^ pcgHash(uint(pass)))
+    );
+
+    return float3(random(state, 0), random(state, 1), random(state, 2));
+}
+
+
+/**
+ * Reverse the order of the bits of an integer.
+ *
+ * @arg value: The value to reverse.
+ *
+ * @returns: The reversed value.
+ */
+inline uint reverseBits(uint value)
+{
+    value = ((value >> uint(1)) & uint(0x55555555)) | ((value & uint(0x55555555)) << uint(1));
+    value = ((value >> uint(2)) & uint(0x33333333)) | ((value & uint(0x33333333)) << uint(2));
+    value = ((value >> uint(4)) & uint(0x0f0f0f0f)) | ((value & uint(0x0f0f0f0f)) << uint(4));
+    value = ((value >> uint(8)) & uint(0x00ff00ff)) | ((value & uint(0x00ff00ff)) << uint(8));
+    return (value >> uint(16)) | (value << uint(16));
+}
+
+
+/**
+ * Owen scramble the bits of a value, so that each bit is flipped
+ * depending on the bits above it. This keeps the stratification of a
+ * low discrepancy sequence while randomizing it.
+ *
+ * https://jcgt.org/published/0009/04/01/
+ *
+ * @arg value: The value to scramble.
+ * @arg seed: The seed of the scramble.
+ *
+ * @returns: The scrambled value.
+ */
+inline uint owenScramble(uint value, const uint seed)
+{
+    value = reverseBits(value);
+    value ^= value * uint(0x3d20adea);
+    value += seed;
+    value *= (seed >> uint(16)) | uint(1);
+    value ^= value * uint(0x05526c56);
+    value ^= value * uint(0x53a22864);
+    return reverseBits(value);
+}
+
+
+/**
+ * Get a point of a two dimensional, Owen scrambled, Sobol sequence.
+ * Every pair of dimensions uses the first two dimensions of the Sobol
+ * sequence, decorrelated from the other pairs by shuffling the order
+ * of the points with its own scramble.
+ *
+ * https://jcgt.org/published/0009/04/01/
+ *
+ * @arg index: The index of the point in the sequence.
+ * @arg dimension: The index of the pair of dimensions.
+ * @arg scramble: The scramble of the sequence, which should differ
+ *     between pixels.
+ *
+ * @returns: A point with coordinates on the interval [0, 1).
+ */
+inline float2 sobolSample(const uint index, const uint dimension, const uint scramble)
+{
+    const uint seed = pcgHash(scramble ^ pcgHash(dimension));
+    uint shuffledIndex = owenScramble(index, seed);
+
+    // The first dimension is the van der Corput sequence, the direction
+    // numbers of the second are built from the polynomial x + 1
+    uint x = reverseBits(shuffledIndex);
+    uint y = 0;
+    uint directionNumber = uint(0x80000000);
+    while (shuffledIndex != uint(0))
+    {
+        if (shuffledIndex & uint(1))
+        {
+            y ^= directionNumber;
+        }
+        shuffledIndex >>= uint(1);
+        directionNumber ^= directionNumber >> uint(1);
+    }
+
+    x = owenScramble(x, pcgHash(seed ^ uint(0x68bc21eb)));
+    y = owenScramble(y, pcgHash(seed ^ uint(0x02e5be93)));
+
+    return float2(float(x >> uint(8)), float(y >> uint(8))) / 16777216.0f;
+}
+
+
 /**
  * Get a random value on the interval [0, 1].
  *
@@ -194,6 +382,19 @@ float3 uniformDirectionInHemisphere(const float3 &axis, const float3 &seed)
 }
 
 
+/**
+ * Create a point that lies within the unit circle.
+ *
+ * @arg uniforms: Two uniform random values on the interval [0, 1].
+ *
+ * @returns: A random point, (radius, angle) in the unit circle.
+ */
+inline float2 uniformPointInUnitCircle(const float2 &uniforms)
+{
+    return float2(sqrt(uniforms.x), 2.0f * PI * uniforms.y);
+}
+
+
 /**
  * Create a random point that lies within the unit circle.
  *
@@ -203,23 +404,23 @@ float3 uniformDirectionInHemisphere(const float3 &axis, const float3 &seed)
  */
 inline float2 uniformPointInUnitCircle(const float3 &seed)
 {
-    return float2(sqrt(random(seed.x)), 2.0f * PI * random(seed.y));
+    return uniformPointInUnitCircle(float2(random(seed.x), random(seed.y)));
 }
 
 
 /**
- * Create a random unit vector in the hemisphere aligned along the
- * z-axis, with a distribution that is cosine weighted.
+ * Create a unit vector in the hemisphere aligned along the z-axis,
+ * with a distribution that is cosine weighted.
  *
- * @arg seed: The random seed.
+ * @arg uniforms: Two uniform random values on the interval [0, 1].
  *
  * @returns: A random unit vector.
  */
-float3 cosineDirectionInZHemisphere(const float3 &seed)
+float3 cosineDirectionInZHemisphere(const float2 &uniforms)
 {
-    const float uniform = random(seed.x);
+    const float uniform = uniforms.x;
     const float r = sqrt(uniform);
-    const float angle = 2 * PI * random(seed.y);
+    const float angle = 2 * PI * uniforms.y;
  
     const float x = r * cos(angle);
     const float y = r * sin(angle);
@@ -228,6 +429,20 @@ float3 cosineDirectionInZHemisphere(const float3 &seed)
 }
 
 
+/**
+ * Create a random unit vector in the hemisphere aligned along the
+ * z-axis, with a distribution that is cosine weighted.
+ *
+ * @arg seed: The random seed.
+ *
+ * @returns: A random unit vector.
+ */
+float3 cosineDirectionInZHemisphere(const float3 &seed)
+{
+    return cosineDirectionInZHemisphere(float2(random(seed.x), random(seed.y)));
+}
+
+
 /**
  * Create a random unit vector in the hemisphere aligned along the
  * given axis, with a distribution that is cosine weighted.
@@ -247,6 +462,25 @@ float3 cosineDirectionInHemisphere(const float3 &axis, const float3 &seed)
 }
 
 
+/**
+ * Create a unit vector in the hemisphere aligned along the given axis,
+ * with a distribution that is cosine weighted.
+ *
+ * @arg axis: The axis to align the hemisphere with.
+ * @arg uniforms: Two uniform random values on the interval [0, 1].
+ *
+ * @returns: A random unit vector.
+ */
+float3 cosineDirectionInHemisphere(const float3 &axis, const float2 &uniforms)
+{
+    return normalize(alignWithDirection(
+        float3(0, 0, 1),
+        axis,
+        cosineDirectionInZHemisphere(uniforms)
+    ));
+}
+
+
 /**
  * Get a random direction within a solid angle oriented along the
  * z-axis.
@@ -0,0 +1,104 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+//
+// Functions for reducing images to their statistics in parallel
+//
+// The partial statistics of a set of values are their minimum, maximum,
+// and mean, and the sum of their squared deviations from the mean, in
+// the x, y, z, and w channels. Partial statistics are merged without a
+// second pass over the values, so tiles of an image can be reduced
+// independently and then combined.
+//
+
+
+/**
+ * Get the partial statistics of an empty set of values.
+ *
+ * @returns: The partial statistics.
+ */
+inline float4 emptyStatistics()
+{
+    return float4(FLT_MAX, -FLT_MAX, 0.0f, 0.0f);
+}
+
+
+/**
+ * Add a value to a set of partial statistics (Welford 1962).
+ *
+ * @arg value: The value to add.
+ * @arg statistics: The partial statistics to add the value to.
+ * @arg count: The number of values in the statistics, which will be
+ *     incremented.
+ */
+inline void addToStatistics(const float value, float4 &statistics, float &count)
+{
+    count += 1.0f;
+
+    const float deviation = value - statistics.z;
+    statistics.x = min(statistics.x, value);
+    statistics.y = max(statistics.y, value);
+    statistics.z += deviation / count;
+    statistics.w += deviation * (value - statistics.z);
+}
+
+
+/**
+ * Merge two sets of partial statistics (Chan et al. 1979).
+ *
+ * @arg other: The partial statistics to merge in.
+ * @arg otherCount: The number of values in the other statistics.
+ * @arg statistics: The partial statistics to merge into.
+ * @arg count: The number of values in the statistics, which will be
+ *     increased by the other count.
+ */
+inline void mergeStatistics(
+        const float4 &other,
+        const float otherCount,
+        float4 &statistics,
+        float &count)
+{
+    if (otherCount <= 0.0f)
+    {
+        return;
+    }
+
+    const float totalCount = count + otherCount;
+    const float deviation = other.z - statistics.z;
+
+    statistics.x = min(statistics.x, other.x);
+    statistics.y = max(statistics.y, other.y);
+    statistics.z += deviation * otherCount / totalCount;
+    statistics.w += other.w + deviation * deviation * count * otherCount / totalCount;
+
+    count = totalCount;
+}
+
+
+/**
+ * Get the minimum, maximum, mean, and standard deviation from a set of
+ * partial statistics.
+ *
+ * @arg statistics: The partial statistics.
+ * @arg count: The number of values in the statistics.
+ *
+ * @returns: The minimum, maximum, mean, and standard deviation in the
+ *     x, y, z, and w channels.
+ */
+inline float4 finalStatistics(const float4 &statistics, const float count)
+{
+    if (count <= 0.0f)
+    {
+        return float4(0);
+    }
+
+    return float4(
+        statistics.x,
+        statistics.y,
+        statistics.z,
+        sqrt(positivePart(statistics.w) / count)
+    );
+}
@@ -0,0 +1,650 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+//
+// The subset of BlinkScript that the kernels use, as plain C++, so that
+// they compile into a CPU renderer without Nuke
+//
+// Define 'kernel' as 'struct', and 'param' and 'local' as 'public',
+// around the include of a kernel. They are ordinary words in C++, so
+// they are left to the file that includes the kernel.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+
+typedef unsigned int uint;
+
+#ifndef PI
+#define PI 3.141592653589793f
+#endif
+
+
+enum ImageAccess { eRead, eWrite, eReadWrite };
+enum AccessPattern { eAccessPoint, eAccessRanged1D, eAccessRanged2D, eAccessRandom };
+enum EdgeMode { eEdgeNone, eEdgeClamped, eEdgeConstant, eEdgePeriodic };
+enum KernelGranularity { ePixelWise, eComponentWise };
+
+
+//
+// Vectors
+//
+
+struct int2
+{
+    int x, y;
+
+    int2() : x(0), y(0) {}
+    int2(int x_, int y_) : x(x_), y(y_) {}
+
+    int &operator[](int i) { return (&x)[i]; }
+    const int &operator[](int i) const { return (&x)[i]; }
+};
+
+
+struct int3
+{
+    int x, y, z;
+
+    int3() : x(0), y(0), z(0) {}
+    int3(int x_, int y_, int z_) : x(x_), y(y_), z(z_) {}
+    int3(float x_, float y_, float z_) : x((int) x_), y((int) y_), z((int) z_) {}
+
+    int &operator[](int i) { return (&x)[i]; }
+    const int &operator[](int i) const { return (&x)[i]; }
+    int3 operator-() const { return int3(-x, -y, -z); }
+};
+
+
+struct int4
+{
+    int x, y, z, w;
+
+    int4() : x(0), y(0), z(0), w(0) {}
+    int4(int x_, int y_, int z_, int w_) : x(x_), y(y_), z(z_), w(w_) {}
+    int4(float x_, float y_, float z_, float w_)
+        : x((int) x_), y((int) y_), z((int) z_), w((int) w_) {}
+
+    int &operator[](int i) { return (&x)[i]; }
+    const int &operator[](int i) const { return (&x)[i]; }
+    int4 operator-() const { return int4(-x, -y, -z, -w); }
+};
+
+
+struct float2
+{
+    float x, y;
+
+    float2() : x(0), y(0) {}
+    float2(float v) : x(v), y(v) {}
+    float2(float x_, float y_) : x(x_), y(y_) {}
+
+    float &operator[](int i) { return (&x)[i]; }
+    const float &operator[](int i) const { return (&x)[i]; }
+};
+
+
+struct float3
+{
+    float x, y, z;
+
+    float3() : x(0), y(0), z(0) {}
+    float3(float v) : x(v), y(v), z(v) {}
+    float3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+    float3(const float2 &v, float z_) : x(v.x), y(v.y), z(z_) {}
+    float3(const int3 &v) : x(v.x), y(v.y), z(v.z) {}
+
+    float &operator[](int i) { return (&x)[i]; }
+    const float &operator[](int i) const { return (&x)[i]; }
+};
+
+
+struct float4
+{
+    float x, y, z, w;
+
+    float4() : x(0), y(0), z(0), w(0) {}
+    float4(float v) : x(v), y(v), z(v), w(v) {}
+    float4(float x_, float y_, float z_, float w_) : x(x_), y(y_), z(z_), w(w_) {}
+    float4(const float3 &v, float w_) : x(v.x), y(v.y), z(v.z), w(w_) {}
+    float4(const int4 &v) : x(v.x), y(v.y), z(v.z), w(v.w) {}
+
+    float &operator[](int i) { return (&x)[i]; }
+    const float &operator[](int i) const { return (&x)[i]; }
+};
+
+
+// The component-wise operators and functions of a float vector type
+#define BLINK_VECTOR_FUNCTIONS(T, N) \
+    inline T operator+(T a, const T &b) { for (int i=0; i < N; i++) a[i] += b[i]; return a; } \
+    inline T operator-(T a, const T &b) { for (int i=0; i < N; i++) a[i] -= b[i]; return a; } \
+    inline T operator*(T a, const T &b) { for (int i=0; i < N; i++) a[i] *= b[i]; return a; } \
+    inline T operator/(T a, const T &b) { for (int i=0; i < N; i++) a[i] /= b[i]; return a; } \
+    inline T operator+(T a, float b) { for (int i=0; i < N; i++) a[i] += b; return a; } \
+    inline T operator-(T a, float b) { for (int i=0; i < N; i++) a[i] -= b; return a; } \
+    inline T operator*(T a, float b) { for (int i=0; i < N; i++) a[i] *= b; return a; } \
+    inline T operator/(T a, float b) { for (int i=0; i < N; i++) a[i] /= b; return a; } \
+    inline T operator+(float b, T a) { for (int i=0; i < N; i++) a[i] = b + a[i]; return a; } \
+    inline T operator-(float b, T a) { for (int i=0; i < N; i++) a[i] = b - a[i]; return a; } \
+    inline T operator*(float b, T a) { for (int i=0; i < N; i++) a[i] = b * a[i]; return a; } \
+    inline T operator/(float b, T a) { for (int i=0; i < N; i++) a[i] = b / a[i]; return a; } \
+    inline T operator-(T a) { for (int i=0; i < N; i++) a[i] = -a[i]; return a; } \
+    inline T &operator+=(T &a, const T &b) { a = a + b; return a; } \
+    inline T &operator-=(T &a, const T &b) { a = a - b; return a; } \
+    inline T &operator*=(T &a, const T &b) { a = a * b; return a; } \
+    inline T &operator/=(T &a, const T &b) { a = a / b; return a; } \
+    inline T &operator+=(T &a, float b) { a = a + b; return a; } \
+    inline T &operator-=(T &a, float b) { a = a - b; return a; } \
+    inline T &operator*=(T &a, float b) { a = a * b; return a; } \
+    inline T &operator/=(T &a, float b) { a = a / b; return a; } \
+    inline float dot(const T &a, const T &b) \
+    { \
+        float sum = 0; \
+        for (int i=0; i < N; i++) sum += a[i] * b[i]; \
+        return sum; \
+    } \
+    inline float length(const T &a) { return std::sqrt(dot(a, a)); } \
+    inline T normalize(const T &a) { return a / length(a); } \
+    inline T fabs(T a) { for (int i=0; i < N; i++) a[i] = std::fabs(a[i]); return a; } \
+    inline T abs(T a) { return fabs(a); } \
+    inline T floor(T a) { for (int i=0; i < N; i++) a[i] = std::floor(a[i]); return a; } \
+    inline T round(T a) { for (int i=0; i < N; i++) a[i] = std::round(a[i]); return a; } \
+    inline T sqrt(T a) { for (int i=0; i < N; i++) a[i] = std::sqrt(a[i]); return a; } \
+    inline T exp(T a) { for (int i=0; i < N; i++) a[i] = std::exp(a[i]); return a; } \
+    inline T log(T a) { for (int i=0; i < N; i++) a[i] = std::log(a[i]); return a; } \
+    inline T sin(T a) { for (int i=0; i < N; i++) a[i] = std::sin(a[i]); return a; } \
+    inline T cos(T a) { for (int i=0; i < N; i++) a[i] = std::cos(a[i]); return a; } \
+    inline T sign(T a) { for (int i=0; i < N; i++) a[i] = (a[i] > 0) - (a[i] < 0); return a; } \
+    inline T fmod(T a, const T &b) { for (int i=0; i < N; i++) a[i] = std::fmod(a[i], b[i]); return a; } \
+    inline T fmod(T a, float b) { for (int i=0; i < N; i++) a[i] = std::fmod(a[i], b); return a; } \
+    inline T pow(T a, const T &b) { for (int i=0; i < N; i++) a[i] = std::pow(a[i], b[i]); return a; } \
+    inline T pow(T a, float b) { for (int i=0; i < N; i++) a[i] = std::pow(a[i], b); return a; } \
+    inline T max(T a, const T &b) { for (int i=0; i < N; i++) a[i] = std::max(a[i], b[i]); return a; } \
+    inline T min(T a, const T &b) { for (int i=0; i < N; i++) a[i] = std::min(a[i], b[i]); return a; } \
+    inline T max(T a, float b) { for (int i=0; i < N; i++) a[i] = std::max(a[i], b); return a; } \
+    inline T min(T a, float b) { for (int i=0; i < N; i++) a[i] = std::min(a[i], b); return a; } \
+    inline float max(const T &a) \
+    { \
+        float value = a[0]; \
+        for (int i=1; i < N; i++) value = std::max(value, a[i]); \
+        return value; \
+    } \
+    inline float min(const T &a) \
+    { \
+        float value = a[0]; \
+        for (int i=1; i < N; i++) value = std::min(value, a[i]); \
+        return value; \
+    } \
+    inline T clamp(T a, const T &lower, const T &upper) \
+    { \
+        for (int i=0; i < N; i++) a[i] = std::min(std::max(a[i], lower[i]), upper[i]); \
+        return a; \
+    }
+
+BLINK_VECTOR_FUNCTIONS(float2, 2)
+BLINK_VECTOR_FUNCTIONS(float3, 3)
+BLINK_VECTOR_FUNCTIONS(float4, 4)
+
+
+inline float3 cross(const float3 &a, const float3 &b)
+{
+    return float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+
+//
+// Scalars
+//
+
+using std::abs;
+using std::acos;
+using std::asin;
+using std::atan;
+using std::atan2;
+using std::cos;
+using std::exp;
+using std::fabs;
+using std::floor;
+using std::fmod;
+using std::log;
+using std::pow;
+using std::round;
+using std::sin;
+using std::sqrt;
+using std::tan;
+
+inline float max(float a, float b) { return a > b ? a : b; }
+inline float min(float a, float b) { return a < b ? a : b; }
+inline int max(int a, int b) { return a > b ? a : b; }
+inline int min(int a, int b) { return a < b ? a : b; }
+inline float max(int a, float b) { return max((float) a, b); }
+inline float max(float a, int b) { return max(a, (float) b); }
+inline float min(int a, float b) { return min((float) a, b); }
+inline float min(float a, int b) { return min(a, (float) b); }
+inline float clamp(float a, float lower, float upper) { return min(max(a, lower), upper); }
+inline int clamp(int a, int lower, int upper) { return min(max(a, lower), upper); }
+inline float sign(float a) { return (float) ((a > 0) - (a < 0)); }
+
+// Reading a float through a uint pointer, as Blink allows, is undefined
+// behaviour in C++, so the kernels use these copies instead
+#define BLINK_HOST_BIT_CASTS
+
+inline uint floatToUint(const float floatValue)
+{
+    static_assert(sizeof(uint) == sizeof(float), "uint and float must be the same size");
+    uint uintValue;
+    std::memcpy(&uintValue, &floatValue, sizeof(uintValue));
+    return uintValue;
+}
+
+inline float uintToFloat(const uint uintValue)
+{
+    float floatValue;
+    std::memcpy(&floatValue, &uintValue, sizeof(floatValue));
+    return floatValue;
+}
+
+// The table free fBm evaluates its octaves together in SIMD lanes
+#define BLINK_HOST_SIMD_NOISE
+#include "simd_noise.h"
+
+
+//
+// Matrices
+//
+
+template<int N>
+struct floatNxN
+{
+    float m[N][N];
+
+    floatNxN()
+    {
+        for (int i=0; i < N; i++)
+        {
+            for (int j=0; j < N; j++)
+            {
+                m[i][j] = i == j;
+            }
+        }
+    }
+
+    template<class... Values, class = typename std::enable_if<sizeof...(Values) == N * N>::type>
+    floatNxN(Values... values)
+    {
+        const float flattened[] = {(float) values...};
+        for (int i=0; i < N; i++)
+        {
+            for (int j=0; j < N; j++)
+            {
+                m[i][j] = flattened[i * N + j];
+            }
+        }
+    }
+
+    float *operator[](int i) { return m[i]; }
+    const float *operator[](int i) const { return m[i]; }
+
+    /**
+     * Invert the matrix by Gauss-Jordan elimination, a singular matrix
+     * gives the identity.
+     */
+    floatNxN invert() const
+    {
+        float augmented[N][2 * N];
+        for (int i=0; i < N; i++)
+        {
+            for (int j=0; j < N; j++)
+            {
+                augmented[i][j] = m[i][j];
+                augmented[i][j + N] = i == j;
+            }
+        }
+
+        for (int column=0; column < N; column++)
+        {
+            int pivot = column;
+            for (int row=column + 1; row < N; row++)
+            {
+                if (std::fabs(augmented[row][column]) > std::fabs(augmented[pivot][column]))
+                {
+                    pivot = row;
+                }
+            }
+            if (pivot != column)
+            {
+                for (int k=0; k < 2 * N; k++)
+                {
+                    std::swap(augmented[pivot][k], augmented[column][k]);
+                }
+            }
+
+            const float divisor = augmented[column][column];
+            if (divisor == 0)
+            {
+                return floatNxN();
+            }
+            for (int k=0; k < 2 * N; k++)
+            {
+                augmented[column][k] /= divisor;
+            }
+
+            for (int row=0; row < N; row++)
+            {
+                if (row == column)
+                {
+                    continue;
+                }
+                const float factor = augmented[row][column];
+                for (int k=0; k < 2 * N; k++)
+                {
+                    augmented[row][k] -= factor * augmented[column][k];
+                }
+            }
+        }
+
+        floatNxN inverse;
+        for (int i=0; i < N; i++)
+        {
+            for (int j=0; j < N; j++)
+            {
+                inverse.m[i][j] = augmented[i][j + N];
+            }
+        }
+        return inverse;
+    }
+
+    floatNxN operator*(const floatNxN &other) const
+    {
+        floatNxN product;
+        for (int i=0; i < N; i++)
+        {
+            for (int j=0; j < N; j++)
+            {
+                product.m[i][j] = 0;
+                for (int k=0; k < N; k++)
+                {
+                    product.m[i][j] += m[i][k] * other.m[k][j];
+                }
+            }
+        }
+        return product;
+    }
+
+    floatNxN transpose() const
+    {
+        floatNxN transposed;
+        for (int i=0; i < N; i++)
+        {
+            for (int j=0; j < N; j++)
+            {
+                transposed.m[i][j] = m[j][i];
+            }
+        }
+        return transposed;
+    }
+};
+
+typedef floatNxN<3> float3x3;
+typedef floatNxN<4> float4x4;
+
+
+//
+// Images
+//
+
+// The pixels of an image, whose bottom left pixel is at (x, y), so that
+// a tile of a larger image can be stored on its own
+struct ImageBuffer
+{
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<float4> pixels;
+
+    void resize(int width_, int height_, int x_=0, int y_=0)
+    {
+        x = x_;
+        y = y_;
+        width = width_;
+        height = height_;
+        pixels.assign((size_t) width * height, float4(0));
+    }
+};
+
+
+struct Bounds
+{
+    int x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+
+    int width() const { return x2 - x1; }
+    int height() const { return y2 - y1; }
+};
+
+
+/**
+ * Get the pixel the calling thread is processing, which the relative
+ * reads and writes of the images are made from.
+ */
+inline int2 &blinkCurrentPosition()
+{
+    static thread_local int2 position;
+    return position;
+}
+
+
+template<ImageAccess Access=eRead, AccessPattern Pattern=eAccessPoint, EdgeMode Edge=eEdgeNone>
+struct Image
+{
+    Bounds bounds;
+    ImageBuffer *buffer = nullptr;
+    int2 rangeMin;
+    int2 rangeMax;
+
+    void bind(ImageBuffer *buffer_)
+    {
+        buffer = buffer_;
+        bounds = Bounds();
+        if (buffer)
+        {
+            bounds.x1 = buffer->x;
+            bounds.y1 = buffer->y;
+            bounds.x2 = buffer->x + buffer->width;
+            bounds.y2 = buffer->y + buffer->height;
+        }
+    }
+
+    void setRange(int xMin, int yMin, int xMax, int yMax)
+    {
+        rangeMin = int2(xMin, yMin);
+        rangeMax = int2(xMax, yMax);
+    }
+    void setRange(int minimum, int maximum) { setRange(minimum, minimum, maximum, maximum); }
+
+    /**
+     * Get the pixel at an absolute position, after the edge handling,
+     * or null if it is outside of an unclamped image.
+     */
+    float4 *pixel(int x, int y) const
+    {
+        if (!buffer || buffer->width == 0 || buffer->height == 0)
+        {
+            return nullptr;
+        }
+
+        x -= buffer->x;
+        y -= buffer->y;
+        if (Edge == eEdgeClamped)
+        {
+            x = std::min(std::max(x, 0), buffer->width - 1);
+            y = std::min(std::max(y, 0), buffer->height - 1);
+        }
+        else if (x < 0 || y < 0 || x >= buffer->width || y >= buffer->height)
+        {
+            return nullptr;
+        }
+        return &buffer->pixels[(size_t) y * buffer->width + x];
+    }
+
+    float4 read(int x, int y) const
+    {
+        const float4 *value = pixel(x, y);
+        return value ? *value : float4(0);
+    }
+
+    /**
+     * Get the absolute position of a read, random access reads are
+     * absolute, and the others are relative to the current pixel.
+     */
+    int2 absolute(int x, int y) const
+    {
+        if (Pattern == eAccessRandom)
+        {
+            return int2(x, y);
+        }
+        const int2 &position = blinkCurrentPosition();
+        return int2(position.x + x, position.y + y);
+    }
+
+    float4 operator()() const
+    {
+        const int2 &position = blinkCurrentPosition();
+        return read(position.x, position.y);
+    }
+    float operator()(int component) const { return (*this)()[component]; }
+    float4 operator()(int x, int y) const
+    {
+        const int2 position = absolute(x, y);
+        return read(position.x, position.y);
+    }
+    float operator()(int x, int y, int component) const { return (*this)(x, y)[component]; }
+    float4 operator()(float x, float y) const { return (*this)((int) x, (int) y); }
+    float operator()(float x, float y, int component) const
+    {
+        return (*this)((int) x, (int) y, component);
+    }
+};
+
+
+// The output image, whose reads return references into the buffer
+template<AccessPattern Pattern, EdgeMode Edge>
+struct Image<eWrite, Pattern, Edge> : Image<eRead, Pattern, Edge>
+{
+    // Where the writes outside of the buffer go
+    float4 discarded;
+
+    float4 &operator()()
+    {
+        const int2 &position = blinkCurrentPosition();
+        float4 *value = this->pixel(position.x, position.y);
+        return value ? *value : discarded;
+    }
+    float &operator()(int component) { return (*this)()[component]; }
+    float4 &operator()(int x, int y)
+    {
+        float4 *value = this->pixel(x, y);
+        return value ? *value : discarded;
+    }
+    float &operator()(int x, int y, int component) { return (*this)(x, y)[component]; }
+};
+
+
+/**
+ * Sample an image with bilinear interpolation, with pixel centres at
+ * half integer positions. The taps that fall outside of the image read
+ * its nearest edge pixel.
+ */
+template<class ImageType>
+inline float4 bilinear(const ImageType &image, float x, float y)
+{
+    const float left = std::floor(x - 0.5f);
+    const float bottom = std::floor(y - 0.5f);
+    const float xWeight = x - 0.5f - left;
+    const float yWeight = y - 0.5f - bottom;
+
+    const Bounds &bounds = image.bounds;
+    const int x0 = clamp((int) left, bounds.x1, bounds.x2 - 1);
+    const int x1 = clamp((int) left + 1, bounds.x1, bounds.x2 - 1);
+    const int y0 = clamp((int) bottom, bounds.y1, bounds.y2 - 1);
+    const int y1 = clamp((int) bottom + 1, bounds.y1, bounds.y2 - 1);
+
+    const float4 bottomLeft = image.read(x0, y0);
+    const float4 bottomRight = image.read(x1, y0);
+    const float4 topLeft = image.read(x0, y1);
+    const float4 topRight = image.read(x1, y1);
+    return (
+        (bottomLeft * (1 - xWeight) + bottomRight * xWeight) * (1 - yWeight)
+        + (topLeft * (1 - xWeight) + topRight * xWeight) * yWeight
+    );
+}
+
+
+//
+// Kernels
+//
+
+enum ParamType
+{
+    eParamBool,
+    eParamInt,
+    eParamInt2,
+    eParamFloat,
+    eParamFloat2,
+    eParamFloat3,
+    eParamFloat4,
+    eParamFloat4x4
+};
+
+inline ParamType paramType(const bool *) { return eParamBool; }
+inline ParamType paramType(const int *) { return eParamInt; }
+inline ParamType paramType(const int2 *) { return eParamInt2; }
+inline ParamType paramType(const float *) { return eParamFloat; }
+inline ParamType paramType(const float2 *) { return eParamFloat2; }
+inline ParamType paramType(const float3 *) { return eParamFloat3; }
+inline ParamType paramType(const float4 *) { return eParamFloat4; }
+inline ParamType paramType(const float4x4 *) { return eParamFloat4x4; }
+
+
+// A parameter of a kernel, found by the label it was defined with
+struct KernelParam
+{
+    ParamType type;
+    void *value;
+};
+
+typedef std::map<std::string, KernelParam> KernelParams;
+
+
+template<KernelGranularity Granularity>
+struct ImageComputationKernel
+{
+    // Where 'define' records the parameters, when it is set
+    KernelParams *blinkParams = nullptr;
+
+    template<class T, class Default>
+    void defineParam(T &value, const char *label, const Default &defaultValue)
+    {
+        value = T(defaultValue);
+        if (blinkParams)
+        {
+            (*blinkParams)[label] = KernelParam{paramType(&value), &value};
+        }
+    }
+};
+
+
+#define SampleType(image) float4
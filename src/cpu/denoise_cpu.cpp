@@ -0,0 +1,190 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+//
+// Denoises a render with chained 'Denoise' kernels on the CPU
+//
+// The beauty is filtered by one kernel per iteration, each reading the
+// output of the last, guided by the 'normal', 'albedo', and 'depth' AOVs
+// of the same render, as the nodes are chained in Nuke.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "blink.h"
+#include "image_io.h"
+#include "image_kernels.h"
+#include "scene.h"
+
+#define kernel struct
+#define param public
+#define local public
+#include "../blink/kernels/denoise.blink"
+#undef kernel
+#undef param
+#undef local
+
+
+struct Options
+{
+    std::string beautyPath;
+    std::string normalPath;
+    std::string albedoPath;
+    std::string depthPath;
+    std::string outputPath;
+    std::vector<std::pair<std::string, std::string>> params;
+    int iterations = 5;
+};
+
+
+static void printUsage()
+{
+    std::fprintf(
+        stderr,
+        "usage: denoise_cpu <beauty> <normal> <albedo> <depth> <output.exr|output.pfm> [options]\n"
+        "\n"
+        "options:\n"
+        "    --set <label>=<values>  set a parameter of every iteration\n"
+        "    --iterations <count>    the number of chained iterations, 5\n"
+    );
+}
+
+
+static bool parseOptions(const int argc, char **argv, Options &options)
+{
+    std::vector<std::string> positional;
+    for (int index=1; index < argc; index++)
+    {
+        const std::string argument = argv[index];
+        const bool hasValue = index + 1 < argc;
+        if (argument == "--set" && hasValue)
+        {
+            const std::string assignment = argv[++index];
+            const size_t equals = assignment.find('=');
+            if (equals == std::string::npos)
+            {
+                return false;
+            }
+            options.params.push_back(std::make_pair(
+                assignment.substr(0, equals),
+                assignment.substr(equals + 1)
+            ));
+        }
+        else if (argument == "--iterations" && hasValue)
+        {
+            options.iterations = std::atoi(argv[++index]);
+        }
+        else if (argument.compare(0, 2, "--") == 0)
+        {
+            return false;
+        }
+        else
+        {
+            positional.push_back(argument);
+        }
+    }
+
+    if (positional.size() != 5 || options.iterations < 0)
+    {
+        return false;
+    }
+    options.beautyPath = positional[0];
+    options.normalPath = positional[1];
+    options.albedoPath = positional[2];
+    options.depthPath = positional[3];
+    options.outputPath = positional[4];
+    return true;
+}
+
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    ImageBuffer beauty;
+    ImageBuffer normal;
+    ImageBuffer albedo;
+    ImageBuffer depth;
+    const std::pair<const std::string *, ImageBuffer *> images[] = {
+        {&options.beautyPath, &beauty},
+        {&options.normalPath, &normal},
+        {&options.albedoPath, &albedo},
+        {&options.depthPath, &depth},
+    };
+    for (const std::pair<const std::string *, ImageBuffer *> &image : images)
+    {
+        if (!readImage(*image.first, *image.second))
+        {
+            std::fprintf(stderr, "cannot read %s\n", image.first->c_str());
+            return 1;
+        }
+    }
+
+    Denoise denoise;
+    KernelParams params;
+    denoise.blinkParams = &params;
+    denoise.define();
+    denoise.blinkParams = nullptr;
+
+    std::string error;
+    for (const std::pair<std::string, std::string> &assignment : options.params)
+    {
+        if (!setParam(params, assignment.first, assignment.second, error))
+        {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+    }
+
+    denoise.normal.bind(&normal);
+    denoise.albedo.bind(&albedo);
+    denoise.depth.bind(&depth);
+
+    // Each iteration reads the output of the last
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ImageBuffer filtered;
+    for (int iteration=0; iteration < options.iterations; iteration++)
+    {
+        denoise._iteration = iteration;
+        denoise.src.bind(&beauty);
+        runKernel(denoise, beauty, filtered);
+        std::swap(beauty, filtered);
+    }
+    const double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+
+    std::unique_ptr<TileWriter> writer = createTileWriter(options.outputPath);
+    if (
+        !writer->open(options.outputPath, beauty.width, beauty.height)
+        || !writer->writeTile(beauty)
+        || !writer->close()
+    )
+    {
+        std::fprintf(stderr, "cannot write %s\n", options.outputPath.c_str());
+        return 1;
+    }
+
+    std::printf(
+        "%dx%d in %d iterations: %.3fs\n",
+        beauty.width,
+        beauty.height,
+        options.iterations,
+        seconds
+    );
+    return 0;
+}
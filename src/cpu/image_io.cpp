@@ -0,0 +1,680 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+#include "image_io.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+
+// The first four bytes of every EXR file
+#define EXR_MAGIC 20000630
+
+// The version field of a single part scanline EXR file, and the flags
+// of the tiled, deep, and multi-part files that are not supported
+#define EXR_VERSION 2
+#define EXR_UNSUPPORTED_FLAGS (0x200 | 0x800 | 0x1000)
+
+// The pixel types of EXR channels
+#define EXR_UINT 0
+#define EXR_HALF 1
+#define EXR_FLOAT 2
+
+
+/**
+ * Check whether this machine stores floats little endian.
+ */
+static bool littleEndian()
+{
+    const uint32_t one = 1;
+    unsigned char firstByte;
+    std::memcpy(&firstByte, &one, 1);
+    return firstByte == 1;
+}
+
+
+/**
+ * Reverse the byte order of a float.
+ */
+static float swapBytes(const float value)
+{
+    unsigned char bytes[4];
+    std::memcpy(bytes, &value, 4);
+    std::swap(bytes[0], bytes[3]);
+    std::swap(bytes[1], bytes[2]);
+
+    float swapped;
+    std::memcpy(&swapped, bytes, 4);
+    return swapped;
+}
+
+
+/**
+ * Check whether a path ends with an extension, ignoring case.
+ */
+static bool hasExtension(const std::string &path, const std::string &extension)
+{
+    if (path.size() < extension.size())
+    {
+        return false;
+    }
+    for (size_t index=0; index < extension.size(); index++)
+    {
+        const char character = path[path.size() - extension.size() + index];
+        if (std::tolower((unsigned char) character) != extension[index])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * Read a little endian 32 bit integer, as EXR files store them.
+ */
+static uint32_t readUint32(const unsigned char *bytes)
+{
+    return (
+        (uint32_t) bytes[0]
+        | (uint32_t) bytes[1] << 8
+        | (uint32_t) bytes[2] << 16
+        | (uint32_t) bytes[3] << 24
+    );
+}
+
+
+/**
+ * Read a little endian 64 bit integer, as EXR files store them.
+ */
+static uint64_t readUint64(const unsigned char *bytes)
+{
+    return (uint64_t) readUint32(bytes) | (uint64_t) readUint32(bytes + 4) << 32;
+}
+
+
+/**
+ * Read a little endian float, as EXR files store them.
+ */
+static float readFloat32(const unsigned char *bytes)
+{
+    const uint32_t bits = readUint32(bytes);
+    float value;
+    std::memcpy(&value, &bits, 4);
+    return value;
+}
+
+
+/**
+ * Convert a 16 bit half float to a float.
+ */
+static float halfToFloat(const uint16_t half)
+{
+    const int exponent = (half >> 10) & 0x1f;
+    const int mantissa = half & 0x3ff;
+
+    float value;
+    if (exponent == 0)
+    {
+        value = std::ldexp((float) mantissa, -24);
+    }
+    else if (exponent == 31)
+    {
+        value = mantissa ? NAN : INFINITY;
+    }
+    else
+    {
+        value = std::ldexp((float) (mantissa | 0x400), exponent - 25);
+    }
+    return half & 0x8000 ? -value : value;
+}
+
+
+/**
+ * Append a little endian 32 bit integer to some bytes.
+ */
+static void appendUint32(std::vector<unsigned char> &bytes, const uint32_t value)
+{
+    for (int shift=0; shift < 32; shift += 8)
+    {
+        bytes.push_back((unsigned char) (value >> shift));
+    }
+}
+
+
+/**
+ * Append a little endian float to some bytes.
+ */
+static void appendFloat32(std::vector<unsigned char> &bytes, const float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, 4);
+    appendUint32(bytes, bits);
+}
+
+
+/**
+ * Append a null terminated string to some bytes.
+ */
+static void appendString(std::vector<unsigned char> &bytes, const std::string &text)
+{
+    bytes.insert(bytes.end(), text.begin(), text.end());
+    bytes.push_back(0);
+}
+
+
+/**
+ * Append an attribute of an EXR header to some bytes.
+ */
+static void appendAttribute(
+        std::vector<unsigned char> &bytes,
+        const std::string &name,
+        const std::string &type,
+        const std::vector<unsigned char> &value)
+{
+    appendString(bytes, name);
+    appendString(bytes, type);
+    appendUint32(bytes, (uint32_t) value.size());
+    bytes.insert(bytes.end(), value.begin(), value.end());
+}
+
+
+/**
+ * Read a null terminated string, that must end within the bytes.
+ *
+ * @arg bytes: The bytes to read from.
+ * @arg offset: The offset to read from, will be moved past the string.
+ * @arg text: The location to store the string.
+ *
+ * @returns: Whether the string was terminated.
+ */
+static bool readString(
+        const std::vector<unsigned char> &bytes,
+        size_t &offset,
+        std::string &text)
+{
+    const size_t start = offset;
+    while (offset < bytes.size() && bytes[offset] != 0)
+    {
+        offset++;
+    }
+    if (offset >= bytes.size())
+    {
+        return false;
+    }
+    text.assign(bytes.begin() + start, bytes.begin() + offset);
+    offset++;
+    return true;
+}
+
+
+bool readPFM(const std::string &path, ImageBuffer &image)
+{
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    char type[3] = {0};
+    int width;
+    int height;
+    float scale;
+    if (
+        std::fscanf(file, "%2s %d %d %f", type, &width, &height, &scale) != 4
+        || (std::strcmp(type, "PF") != 0 && std::strcmp(type, "Pf") != 0)
+        || width <= 0
+        || height <= 0
+    ) {
+        std::fclose(file);
+        return false;
+    }
+
+    // A single whitespace character separates the header from the data
+    std::fgetc(file);
+
+    const int numChannels = type[1] == 'F' ? 3 : 1;
+    const bool swap = (scale < 0.0f) != littleEndian();
+
+    std::vector<float> row((size_t) width * numChannels);
+    image.resize(width, height);
+    for (int y=0; y < height; y++)
+    {
+        if (std::fread(row.data(), sizeof(float), row.size(), file) != row.size())
+        {
+            std::fclose(file);
+            return false;
+        }
+
+        for (int x=0; x < width; x++)
+        {
+            float4 &pixel = image.pixels[(size_t) y * width + x];
+            for (int channel=0; channel < 3; channel++)
+            {
+                const float value = row[x * numChannels + channel % numChannels];
+                pixel[channel] = swap ? swapBytes(value) : value;
+            }
+            pixel.w = 1.0f;
+        }
+    }
+
+    std::fclose(file);
+    return true;
+}
+
+
+// A channel of an EXR file, and the channel of the image it fills
+struct EXRChannel
+{
+    int pixelType;
+    int target; // 0 to 3 for RGBA, 4 for all of RGB, or -1 to skip
+};
+
+
+bool readEXR(const std::string &path, ImageBuffer &image)
+{
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        return false;
+    }
+    std::vector<unsigned char> bytes;
+    unsigned char buffer[65536];
+    size_t numRead;
+    while ((numRead = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        bytes.insert(bytes.end(), buffer, buffer + numRead);
+    }
+    std::fclose(file);
+
+    if (
+        bytes.size() < 8
+        || readUint32(bytes.data()) != EXR_MAGIC
+        || (readUint32(bytes.data() + 4) & 0xff) != EXR_VERSION
+        || (readUint32(bytes.data() + 4) & EXR_UNSUPPORTED_FLAGS)
+    ) {
+        return false;
+    }
+
+    // The header is a list of attributes, ended by an empty name
+    std::vector<EXRChannel> channels;
+    int compression = -1;
+    int dataWindow[4] = {0, 0, -1, -1};
+    size_t offset = 8;
+    while (offset < bytes.size() && bytes[offset] != 0)
+    {
+        std::string name;
+        std::string type;
+        if (
+            !readString(bytes, offset, name)
+            || !readString(bytes, offset, type)
+            || offset + 4 > bytes.size()
+        ) {
+            return false;
+        }
+        const size_t size = readUint32(bytes.data() + offset);
+        offset += 4;
+        if (offset + size > bytes.size())
+        {
+            return false;
+        }
+        const size_t end = offset + size;
+
+        if (name == "channels" && type == "chlist")
+        {
+            std::string channelName;
+            while (offset < end && bytes[offset] != 0)
+            {
+                if (!readString(bytes, offset, channelName) || offset + 16 > end)
+                {
+                    return false;
+                }
+                EXRChannel channel;
+                channel.pixelType = (int) readUint32(bytes.data() + offset);
+                const size_t dot = channelName.find_last_of('.');
+                const std::string suffix = (
+                    dot == std::string::npos ? channelName : channelName.substr(dot + 1)
+                );
+                channel.target = (
+                    suffix == "R" ? 0
+                    : suffix == "G" ? 1
+                    : suffix == "B" ? 2
+                    : suffix == "A" ? 3
+                    : suffix == "Y" ? 4
+                    : -1
+                );
+
+                // Only the channels of the default layer are read
+                if (dot != std::string::npos)
+                {
+                    channel.target = -1;
+                }
+                if (
+                    channel.pixelType < EXR_UINT
+                    || channel.pixelType > EXR_FLOAT
+                    || readUint32(bytes.data() + offset + 8) != 1
+                    || readUint32(bytes.data() + offset + 12) != 1
+                ) {
+                    return false;
+                }
+                channels.push_back(channel);
+                offset += 16;
+            }
+        }
+        else if (name == "compression" && size == 1)
+        {
+            compression = bytes[offset];
+        }
+        else if (name == "dataWindow" && size == 16)
+        {
+            for (int index=0; index < 4; index++)
+            {
+                dataWindow[index] = (int) readUint32(bytes.data() + offset + 4 * index);
+            }
+        }
+        offset = end;
+    }
+    offset++;
+
+    const int width = dataWindow[2] - dataWindow[0] + 1;
+    const int height = dataWindow[3] - dataWindow[1] + 1;
+    if (compression != 0 || channels.empty() || width <= 0 || height <= 0)
+    {
+        return false;
+    }
+
+    size_t lineSize = 0;
+    for (const EXRChannel &channel : channels)
+    {
+        lineSize += (size_t) width * (channel.pixelType == EXR_HALF ? 2 : 4);
+    }
+    if (offset + (size_t) height * 8 > bytes.size())
+    {
+        return false;
+    }
+
+    image.resize(width, height);
+    for (float4 &pixel : image.pixels)
+    {
+        pixel.w = 1.0f;
+    }
+
+    // Without compression every chunk holds a single scanline
+    for (int line=0; line < height; line++)
+    {
+        const uint64_t chunk = readUint64(bytes.data() + offset + 8 * line);
+        if (chunk + 8 + lineSize > bytes.size())
+        {
+            return false;
+        }
+        const int lineY = (int) readUint32(bytes.data() + chunk) - dataWindow[1];
+        if (
+            lineY < 0
+            || lineY >= height
+            || readUint32(bytes.data() + chunk + 4) != lineSize
+        ) {
+            return false;
+        }
+
+        // The first scanline of the file is the top row of the image
+        float4 *row = image.pixels.data() + (size_t) (height - 1 - lineY) * width;
+        const unsigned char *data = bytes.data() + chunk + 8;
+        for (const EXRChannel &channel : channels)
+        {
+            const int sampleSize = channel.pixelType == EXR_HALF ? 2 : 4;
+            for (int x=0; channel.target >= 0 && x < width; x++)
+            {
+                const unsigned char *sample = data + x * sampleSize;
+                const float value = (
+                    channel.pixelType == EXR_HALF
+                    ? halfToFloat((uint16_t) (sample[0] | sample[1] << 8))
+                    : channel.pixelType == EXR_FLOAT
+                    ? readFloat32(sample)
+                    : (float) readUint32(sample)
+                );
+                if (channel.target == 4)
+                {
+                    row[x].x = value;
+                    row[x].y = value;
+                    row[x].z = value;
+                }
+                else
+                {
+                    row[x][channel.target] = value;
+                }
+            }
+            data += (size_t) width * sampleSize;
+        }
+    }
+    return true;
+}
+
+
+bool readImage(const std::string &path, ImageBuffer &image)
+{
+    return hasExtension(path, ".exr") ? readEXR(path, image) : readPFM(path, image);
+}
+
+
+TileWriter::~TileWriter()
+{
+    close();
+}
+
+
+bool TileWriter::close()
+{
+    if (!_file)
+    {
+        return !_failed;
+    }
+
+    _failed |= std::fclose(_file) != 0;
+    _file = nullptr;
+    return !_failed;
+}
+
+
+bool PFMTileWriter::open(const std::string &path, const int width, const int height)
+{
+    close();
+
+    _file = std::fopen(path.c_str(), "wb");
+    if (!_file)
+    {
+        return false;
+    }
+
+    _width = width;
+    _height = height;
+    _failed = std::fprintf(
+        _file,
+        "PF\n%d %d\n%s\n",
+        width,
+        height,
+        littleEndian() ? "-1.0" : "1.0"
+    ) < 0;
+    _dataStart = std::ftell(_file);
+
+    // Reserve the whole image, so the tiles can be written in any order
+    const float zero[3] = {0, 0, 0};
+    std::fseek(_file, _dataStart + ((long) width * height - 1) * sizeof(zero), SEEK_SET);
+    _failed |= std::fwrite(zero, sizeof(zero), 1, _file) != 1;
+
+    return !_failed;
+}
+
+
+bool PFMTileWriter::writeTile(const ImageBuffer &tile)
+{
+    if (!_file)
+    {
+        return false;
+    }
+
+    std::vector<float> row((size_t) tile.width * 3);
+    for (int y=0; y < tile.height; y++)
+    {
+        for (int x=0; x < tile.width; x++)
+        {
+            const float4 &pixel = tile.pixels[(size_t) y * tile.width + x];
+            row[3 * x] = pixel.x;
+            row[3 * x + 1] = pixel.y;
+            row[3 * x + 2] = pixel.z;
+        }
+
+        const long offset = _dataStart + (
+            (long) (tile.y + y) * _width + tile.x
+        ) * 3 * sizeof(float);
+        if (
+            std::fseek(_file, offset, SEEK_SET) != 0
+            || std::fwrite(row.data(), sizeof(float), row.size(), _file) != row.size()
+        ) {
+            _failed = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool EXRTileWriter::open(const std::string &path, const int width, const int height)
+{
+    close();
+
+    _file = std::fopen(path.c_str(), "wb");
+    if (!_file)
+    {
+        return false;
+    }
+
+    _width = width;
+    _height = height;
+    _failed = false;
+
+    std::vector<unsigned char> header;
+    appendUint32(header, EXR_MAGIC);
+    appendUint32(header, EXR_VERSION);
+
+    // The channels must be listed in alphabetical order, which is also
+    // the order of their samples within each scanline
+    std::vector<unsigned char> value;
+    for (const char *channel : {"A", "B", "G", "R"})
+    {
+        appendString(value, channel);
+        appendUint32(value, EXR_FLOAT);
+        appendUint32(value, 0); // linear, and three reserved bytes
+        appendUint32(value, 1); // x sampling
+        appendUint32(value, 1); // y sampling
+    }
+    value.push_back(0);
+    appendAttribute(header, "channels", "chlist", value);
+
+    appendAttribute(header, "compression", "compression", {0});
+
+    value.clear();
+    appendUint32(value, 0);
+    appendUint32(value, 0);
+    appendUint32(value, (uint32_t) (width - 1));
+    appendUint32(value, (uint32_t) (height - 1));
+    appendAttribute(header, "dataWindow", "box2i", value);
+    appendAttribute(header, "displayWindow", "box2i", value);
+
+    appendAttribute(header, "lineOrder", "lineOrder", {0});
+
+    value.clear();
+    appendFloat32(value, 1.0f);
+    appendAttribute(header, "pixelAspectRatio", "float", value);
+    appendAttribute(header, "screenWindowWidth", "float", value);
+
+    value.clear();
+    appendFloat32(value, 0.0f);
+    appendFloat32(value, 0.0f);
+    appendAttribute(header, "screenWindowCenter", "v2f", value);
+    header.push_back(0);
+
+    // Every scanline is the same size, so the offsets are known up front
+    const uint32_t lineSize = (uint32_t) width * 4 * sizeof(float);
+    _dataStart = (long) header.size() + (long) height * 8;
+    for (int line=0; line < height; line++)
+    {
+        const uint64_t chunk = _dataStart + (uint64_t) line * (8 + lineSize);
+        appendUint32(header, (uint32_t) chunk);
+        appendUint32(header, (uint32_t) (chunk >> 32));
+    }
+    _failed |= std::fwrite(header.data(), 1, header.size(), _file) != header.size();
+
+    // Give every scanline its header, leaving the samples to the tiles,
+    // and reserve the whole image, so the tiles can be written in any order
+    for (int line=0; line < height; line++)
+    {
+        std::vector<unsigned char> lineHeader;
+        appendUint32(lineHeader, (uint32_t) line);
+        appendUint32(lineHeader, lineSize);
+        _failed |= (
+            std::fseek(_file, _dataStart + (long) line * (8 + lineSize), SEEK_SET) != 0
+            || std::fwrite(lineHeader.data(), 1, 8, _file) != 8
+        );
+    }
+    const unsigned char zero = 0;
+    std::fseek(_file, _dataStart + (long) height * (8 + lineSize) - 1, SEEK_SET);
+    _failed |= std::fwrite(&zero, 1, 1, _file) != 1;
+
+    return !_failed;
+}
+
+
+bool EXRTileWriter::writeTile(const ImageBuffer &tile)
+{
+    if (!_file)
+    {
+        return false;
+    }
+
+    const long lineSize = 8 + (long) _width * 4 * sizeof(float);
+    const int channels[4] = {3, 2, 1, 0}; // A, B, G, and R
+    std::vector<unsigned char> samples;
+    for (int y=0; y < tile.height; y++)
+    {
+        const int line = _height - 1 - (tile.y + y);
+        for (int channel=0; channel < 4; channel++)
+        {
+            samples.clear();
+            for (int x=0; x < tile.width; x++)
+            {
+                appendFloat32(
+                    samples,
+                    tile.pixels[(size_t) y * tile.width + x][channels[channel]]
+                );
+            }
+
+            const long offset = _dataStart + line * lineSize + 8 + (
+                (long) channel * _width + tile.x
+            ) * sizeof(float);
+            if (
+                std::fseek(_file, offset, SEEK_SET) != 0
+                || std::fwrite(samples.data(), 1, samples.size(), _file) != samples.size()
+            ) {
+                _failed = true;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+std::unique_ptr<TileWriter> createTileWriter(const std::string &path)
+{
+    if (hasExtension(path, ".exr"))
+    {
+        return std::unique_ptr<TileWriter>(new EXRTileWriter());
+    }
+    return std::unique_ptr<TileWriter>(new PFMTileWriter());
+}
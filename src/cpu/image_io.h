@@ -0,0 +1,140 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+//
+// Reading and writing images
+//
+// PFM files store their rows from the bottom up, as Nuke numbers them,
+// so the rows of a file and of an image buffer line up. EXR files store
+// them from the top down, and are flipped as they are read and written.
+//
+// Only uncompressed, single part, scanline EXR files are supported,
+// which is all the renderer writes, and what Nuke writes with its
+// compression set to 'none'. That keeps the renderer free of any
+// dependencies.
+//
+
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "blink.h"
+
+
+/**
+ * Read a PFM image, the alpha of every pixel is 1.
+ *
+ * @arg path: The file to read.
+ * @arg image: The location to store the image.
+ *
+ * @returns: Whether the file was read.
+ */
+bool readPFM(const std::string &path, ImageBuffer &image);
+
+
+/**
+ * Read an uncompressed scanline EXR image. The R, G, B, and A channels
+ * are read, in half, float, or uint, a Y channel fills all of R, G, and
+ * B, and the alpha is 1 without an A channel.
+ *
+ * @arg path: The file to read.
+ * @arg image: The location to store the image.
+ *
+ * @returns: Whether the file was read.
+ */
+bool readEXR(const std::string &path, ImageBuffer &image);
+
+
+/**
+ * Read an EXR, or PFM, image, by the extension of its path.
+ *
+ * @arg path: The file to read.
+ * @arg image: The location to store the image.
+ *
+ * @returns: Whether the file was read.
+ */
+bool readImage(const std::string &path, ImageBuffer &image);
+
+
+// Writes the tiles of an image as they finish, so only the tiles being
+// rendered are ever held in memory
+class TileWriter
+{
+public:
+    virtual ~TileWriter();
+
+    /**
+     * Create the file, and reserve space for the whole image.
+     *
+     * @arg path: The file to write.
+     * @arg width: The width of the image.
+     * @arg height: The height of the image.
+     *
+     * @returns: Whether the file was created.
+     */
+    virtual bool open(const std::string &path, const int width, const int height) = 0;
+
+    /**
+     * Write a tile into place.
+     *
+     * @arg tile: The tile, positioned within the image.
+     *
+     * @returns: Whether the tile was written.
+     */
+    virtual bool writeTile(const ImageBuffer &tile) = 0;
+
+    /**
+     * Finish writing the file.
+     *
+     * @returns: Whether every write succeeded.
+     */
+    bool close();
+
+protected:
+    FILE *_file = nullptr;
+    int _width = 0;
+    int _height = 0;
+    bool _failed = false;
+};
+
+
+// Writes the red, green, and blue channels as a PFM image
+class PFMTileWriter : public TileWriter
+{
+public:
+    bool open(const std::string &path, const int width, const int height) override;
+    bool writeTile(const ImageBuffer &tile) override;
+
+private:
+    long _dataStart = 0;
+};
+
+
+// Writes all four channels as an uncompressed scanline EXR image of
+// 32 bit floats, whose every scanline has the same size, so the tiles
+// can be written in any order
+class EXRTileWriter : public TileWriter
+{
+public:
+    bool open(const std::string &path, const int width, const int height) override;
+    bool writeTile(const ImageBuffer &tile) override;
+
+private:
+    long _dataStart = 0;
+};
+
+
+/**
+ * Create the writer for an image, by the extension of its path, EXR
+ * for '.exr' and PFM otherwise.
+ *
+ * @arg path: The file that will be written.
+ *
+ * @returns: The writer, which is yet to be opened.
+ */
+std::unique_ptr<TileWriter> createTileWriter(const std::string &path);
@@ -0,0 +1,84 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+//
+// Running the image processing kernels over whole images on the CPU
+//
+// The output of each kernel takes the format of its source image, and
+// every pixel is processed in turn on the calling thread.
+//
+// The kernels include the same headers, which have no include guards,
+// so each kernel is compiled in a translation unit of its own.
+//
+
+#pragma once
+
+#include "blink.h"
+
+
+/**
+ * Initialize a kernel, and process every pixel of its output, which is
+ * given the format of a source image.
+ *
+ * @arg kernel: The kernel, with its params set and its inputs bound.
+ * @arg src: The image whose format to output.
+ * @arg dst: The location to store the output.
+ */
+template<class Kernel>
+void runKernel(Kernel &kernel, const ImageBuffer &src, ImageBuffer &dst)
+{
+    dst.resize(src.width, src.height, src.x, src.y);
+    kernel.dst.bind(&dst);
+    kernel.init();
+
+    for (int y=src.y; y < src.y + src.height; y++)
+    {
+        for (int x=src.x; x < src.x + src.width; x++)
+        {
+            blinkCurrentPosition() = int2(x, y);
+            kernel.process(int2(x, y));
+        }
+    }
+}
+
+
+/**
+ * Run the 'VarianceRows' kernel, the horizontal pass of the separable
+ * variance.
+ *
+ * @arg src: The image to compute the variance of.
+ * @arg range: The number of pixels either side of the centre of a row.
+ * @arg squaredDeviations: Output the sums of the squared deviations of
+ *     the rows rather than their means.
+ * @arg dst: The location to store the output.
+ */
+void runVarianceRows(
+        ImageBuffer &src,
+        const float range,
+        const bool squaredDeviations,
+        ImageBuffer &dst);
+
+
+/**
+ * Run the 'Variance' kernel.
+ *
+ * @arg src: The image to compute the variance of.
+ * @arg rowMeans: The row means from the 'VarianceRows' kernel, only
+ *     read when separable.
+ * @arg rowSquaredDeviations: The row sums of squared deviations from the
+ *     'VarianceRows' kernel, only read when separable.
+ * @arg range: The number of pixels either side of the centre of the
+ *     window, in x and y.
+ * @arg separable: Merge the rows rather than reading the whole window.
+ * @arg dst: The location to store the output.
+ */
+void runVariance(
+        ImageBuffer &src,
+        ImageBuffer &rowMeans,
+        ImageBuffer &rowSquaredDeviations,
+        const float2 &range,
+        const bool separable,
+        ImageBuffer &dst);
@@ -0,0 +1,1050 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+//
+// Renders a scene with the 'RayMarchKernel' on the CPU, tile by tile
+//
+// Each tile is an independent work item, rendered into its own buffer
+// and written into place in the output file as soon as it is done, so
+// the memory used by the output scales with the tile size rather than
+// the frame size. The threads take the tiles from a work stealing
+// scheduler, and the pixels of a tile are rendered in Morton order, in
+// packets of eight that march their camera rays together.
+//
+// Every thread has its own copy of the kernel, whose locals are its
+// scratch state, and the kernel seeds its random numbers from the pixel,
+// so the image does not depend on which thread renders which tile.
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "blink.h"
+#include "image_io.h"
+#include "image_kernels.h"
+#include "scene.h"
+#include "tile_scheduler.h"
+#include "tiles.h"
+
+#define kernel struct
+#define param public
+#define local public
+#include "../blink/kernels/ray_march.blink"
+#undef kernel
+#undef param
+#undef local
+
+// Uses the output types of the kernel
+#include "ray_packets.h"
+
+
+// What a tile cost to render
+struct TileStats
+{
+    double seconds = 0.0;
+    double paths = 0.0;
+    float minPaths = 0.0f;
+    float maxPaths = 0.0f;
+    PacketStats packets;
+};
+
+
+// What a thread did over the frame
+struct ThreadStats
+{
+    double busySeconds = 0.0;
+    int tiles = 0;
+    int stolenTiles = 0;
+};
+
+
+struct Options
+{
+    std::string scenePath;
+    std::string outputPath;
+    std::vector<std::pair<std::string, std::string>> params;
+    int width = 0;
+    int height = 0;
+    int tileSize = 16;
+    TileOrder tileOrder = eSpiralOrder;
+    int numThreads = 0;
+    bool packets = true;
+    float packetCoverage = 0.5f;
+    bool quiet = false;
+    int benchmarkRays = 0;
+    int benchmarkNoise = 0;
+    int benchmarkVariance = 0;
+    bool selfCheck = false;
+};
+
+
+static void printUsage()
+{
+    std::fprintf(
+        stderr,
+        "usage: ray_march_cpu <scene> <output.exr|output.pfm> [options]\n"
+        "       ray_march_cpu <scene> --benchmark-camera-rays <count> [options]\n"
+        "       ray_march_cpu <scene> --benchmark-noise <count> [options]\n"
+        "       ray_march_cpu --benchmark-variance <range> [--format <w> <h>]\n"
+        "       ray_march_cpu --self-check\n"
+        "\n"
+        "options:\n"
+        "    --set <label>=<values>  set a parameter, after the scene file\n"
+        "    --format <w> <h>        the output size, the screen size by default\n"
+        "    --tile-size <pixels>    the width and height of the tiles, 16\n"
+        "    --tile-order <order>    scanline, spiral, or hilbert, spiral\n"
+        "    --threads <count>       the number of threads, every core by default\n"
+        "    --scalar                march every camera ray alone, not in packets\n"
+        "    --packet-coverage <f>   how much of the distance to the nearest surface\n"
+        "                            the cone of a packet can cover before it\n"
+        "                            splits into its pixels, 0.5\n"
+        "    --quiet                 only print the totals, not every tile\n"
+        "    --benchmark-camera-rays <count>\n"
+        "                            time generating that many camera rays with\n"
+        "                            the pinhole, depth of field, and latlong\n"
+        "                            cameras, instead of rendering\n"
+        "    --benchmark-noise <count>\n"
+        "                            time that many fBm evaluations with 1 to 12\n"
+        "                            octaves of the LUT and table free noise,\n"
+        "                            instead of rendering\n"
+        "    --benchmark-variance <range>\n"
+        "                            time the direct and separable variance of a\n"
+        "                            noisy image, 1024x778 by default, with\n"
+        "                            windows of 1 up to that range, instead of\n"
+        "                            rendering\n"
+        "    --self-check            check the round trips of the packed\n"
+        "                            encodings of the kernel, and the SIMD\n"
+        "                            noise against the scalar noise, instead\n"
+        "                            of rendering\n"
+    );
+}
+
+
+static bool parseOptions(const int argc, char **argv, Options &options)
+{
+    std::vector<std::string> positional;
+    for (int index=1; index < argc; index++)
+    {
+        const std::string argument = argv[index];
+        const bool hasValue = index + 1 < argc;
+        if (argument == "--set" && hasValue)
+        {
+            const std::string assignment = argv[++index];
+            const size_t equals = assignment.find('=');
+            if (equals == std::string::npos)
+            {
+                return false;
+            }
+            options.params.push_back(std::make_pair(
+                assignment.substr(0, equals),
+                assignment.substr(equals + 1)
+            ));
+        }
+        else if (argument == "--format" && index + 2 < argc)
+        {
+            options.width = std::atoi(argv[++index]);
+            options.height = std::atoi(argv[++index]);
+        }
+        else if (argument == "--tile-size" && hasValue)
+        {
+            options.tileSize = std::atoi(argv[++index]);
+        }
+        else if (argument == "--tile-order" && hasValue)
+        {
+            if (!parseTileOrder(argv[++index], options.tileOrder))
+            {
+                return false;
+            }
+        }
+        else if (argument == "--threads" && hasValue)
+        {
+            options.numThreads = std::atoi(argv[++index]);
+        }
+        else if (argument == "--scalar")
+        {
+            options.packets = false;
+        }
+        else if (argument == "--packet-coverage" && hasValue)
+        {
+            options.packetCoverage = (float) std::atof(argv[++index]);
+        }
+        else if (argument == "--quiet")
+        {
+            options.quiet = true;
+        }
+        else if (argument == "--benchmark-camera-rays" && hasValue)
+        {
+            options.benchmarkRays = std::atoi(argv[++index]);
+        }
+        else if (argument == "--benchmark-noise" && hasValue)
+        {
+            options.benchmarkNoise = std::atoi(argv[++index]);
+        }
+        else if (argument == "--benchmark-variance" && hasValue)
+        {
+            options.benchmarkVariance = std::atoi(argv[++index]);
+        }
+        else if (argument == "--self-check")
+        {
+            options.selfCheck = true;
+        }
+        else if (argument.compare(0, 2, "--") == 0)
+        {
+            return false;
+        }
+        else
+        {
+            positional.push_back(argument);
+        }
+    }
+
+    const bool benchmarking = options.benchmarkRays > 0 || options.benchmarkNoise > 0;
+    if (
+        positional.size() != (
+            options.selfCheck || options.benchmarkVariance > 0 ? 0 : benchmarking ? 1 : 2
+        )
+        || options.tileSize <= 0
+        || options.packetCoverage <= 0.0f
+        || options.benchmarkRays < 0
+        || options.benchmarkNoise < 0
+        || options.benchmarkVariance < 0
+    )
+    {
+        return false;
+    }
+    options.scenePath = positional.size() > 0 ? positional[0] : "";
+    options.outputPath = positional.size() > 1 ? positional[1] : "";
+    return true;
+}
+
+
+/**
+ * Bind the scene images to the inputs of the kernel, the inputs that the
+ * scene leaves out are bound to an empty image.
+ */
+static void bindInputs(Scene &scene, ImageBuffer &empty, RayMarchKernel &rayMarch)
+{
+#define BIND_INPUT(name) rayMarch.name.bind( \
+        scene.images.count(#name) ? &scene.images[#name] : &empty \
+    )
+
+    BIND_INPUT(noise);
+    BIND_INPUT(src);
+    BIND_INPUT(variance);
+    BIND_INPUT(guide);
+    BIND_INPUT(hdri);
+    BIND_INPUT(positions);
+    BIND_INPUT(rotations);
+    BIND_INPUT(dimensions);
+    BIND_INPUT(diffusivities);
+    BIND_INPUT(specularities);
+    BIND_INPUT(transmittances);
+    BIND_INPUT(emittances);
+    BIND_INPUT(scatteringCoefficients);
+    BIND_INPUT(shapeProperties);
+    BIND_INPUT(shapeModParameters0);
+    BIND_INPUT(shapeModParameters1);
+    BIND_INPUT(surfaceProperties);
+    BIND_INPUT(materials);
+    BIND_INPUT(materialIndices);
+    BIND_INPUT(noiseParams0);
+    BIND_INPUT(noiseParams1);
+    BIND_INPUT(noiseParams2);
+    BIND_INPUT(noiseParams3);
+    BIND_INPUT(noiseParams4);
+    BIND_INPUT(noiseParams5);
+    BIND_INPUT(noiseParams6);
+    BIND_INPUT(lights);
+    BIND_INPUT(lightProperties);
+    BIND_INPUT(lightProperties1);
+    BIND_INPUT(irradiance);
+    BIND_INPUT(noiseVolume);
+    BIND_INPUT(velocities);
+
+#undef BIND_INPUT
+}
+
+
+/**
+ * Get the number of paths traced for a pixel, if the output type
+ * records it.
+ */
+static float pathsInPixel(const int outputType, const float4 &pixel)
+{
+    if (outputType == CONVERGENCE_AOV || outputType == MOMENTS_AOV)
+    {
+        return pixel.w;
+    }
+    if (outputType <= STATS_AOV || outputType == ALBEDO_AOV)
+    {
+        return decodeTwoValuesFromUint(pixel.w).y;
+    }
+    return 0.0f;
+}
+
+
+/**
+ * Render a pixel, starting its camera rays part way along.
+ *
+ * @arg rayMarch: The initialized kernel, owned by the calling thread.
+ * @arg position: The pixel to render.
+ * @arg primaryRayStart: The distance along the camera rays known to be
+ *     empty.
+ * @arg primaryRaySteps: The distance evaluations it took to find that.
+ * @arg stats: The location to add the paths traced to.
+ */
+static void renderPixel(
+        RayMarchKernel &rayMarch,
+        const int2 &position,
+        const float primaryRayStart,
+        const int primaryRaySteps,
+        TileStats &stats)
+{
+    blinkCurrentPosition() = position;
+    rayMarch.__primaryRayStart = primaryRayStart;
+    rayMarch.__primaryRaySteps = primaryRaySteps;
+    rayMarch.process(position);
+
+    const float paths = pathsInPixel(rayMarch._outputType, rayMarch.dst());
+    stats.paths += paths;
+    stats.minPaths = min(stats.minPaths, paths);
+    stats.maxPaths = max(stats.maxPaths, paths);
+}
+
+
+/**
+ * Render a tile, in Morton order, eight pixels at a time.
+ *
+ * @arg rayMarch: The initialized kernel, owned by the calling thread.
+ * @arg tile: The tile to render.
+ * @arg options: Whether, and how, to march the camera rays in packets.
+ * @arg output: The location to store the tile.
+ *
+ * @returns: What the tile cost to render.
+ */
+static TileStats renderTile(
+        RayMarchKernel &rayMarch,
+        const Tile &tile,
+        const Options &options,
+        ImageBuffer &output)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    output.resize(tile.width, tile.height, tile.x, tile.y);
+    rayMarch.dst.bind(&output);
+
+    const bool usePackets = options.packets && packetsSupported(rayMarch);
+
+    // The Morton curve covers a power of two square, skip what is outside
+    int size = 1;
+    while (size < tile.width || size < tile.height)
+    {
+        size *= 2;
+    }
+
+    TileStats stats;
+    stats.minPaths = FLT_MAX;
+    for (int first=0; first < size * size; first += PACKET_WIDTH)
+    {
+        int2 positions[PACKET_WIDTH];
+        int2 pixels[PACKET_WIDTH];
+        unsigned int activeLanes = 0;
+        int firstActive = -1;
+        for (int lane=0; lane < PACKET_WIDTH; lane++)
+        {
+            int x;
+            int y;
+            mortonPoint(first + lane, x, y);
+            positions[lane] = int2(tile.x + x, tile.y + y);
+            if (x < tile.width && y < tile.height)
+            {
+                activeLanes |= 1u << lane;
+                firstActive = firstActive < 0 ? lane : firstActive;
+            }
+        }
+        if (!activeLanes)
+        {
+            continue;
+        }
+
+        // A packet traces the rays of one view, so the few that straddle
+        // two views march every pixel from the camera
+        const int view = pixelView(rayMarch, positions[firstActive]);
+        bool singleView = view >= 0;
+        for (int lane=0; lane < PACKET_WIDTH; lane++)
+        {
+            singleView &= (
+                !(activeLanes & (1u << lane))
+                || pixelView(rayMarch, positions[lane]) == view
+            );
+        }
+
+        FloatPack primaryRayStarts = {};
+        IntPack primaryRaySteps = {};
+        if (usePackets && singleView)
+        {
+            for (int lane=0; lane < PACKET_WIDTH; lane++)
+            {
+                pixels[lane] = formatPixel(
+                    rayMarch,
+                    positions[activeLanes & (1u << lane) ? lane : firstActive]
+                );
+            }
+            marchPacket(
+                rayMarch,
+                pixels,
+                view,
+                activeLanes,
+                options.packetCoverage,
+                primaryRayStarts,
+                primaryRaySteps,
+                stats.packets
+            );
+        }
+
+        for (int lane=0; lane < PACKET_WIDTH; lane++)
+        {
+            if (activeLanes & (1u << lane))
+            {
+                renderPixel(
+                    rayMarch,
+                    positions[lane],
+                    primaryRayStarts.lane[lane],
+                    primaryRaySteps.lane[lane],
+                    stats
+                );
+            }
+        }
+    }
+
+    stats.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+    return stats;
+}
+
+
+/**
+ * Time generating camera rays with each kind of camera, sweeping the
+ * pixels of the format, and print the throughput of each. The samples
+ * within the pixels and on the lens are drawn up front, so that only
+ * the rays themselves are timed.
+ *
+ * @arg rayMarch: The kernel with its params set, it is initialized again
+ *     for each camera.
+ * @arg numRays: The number of rays to generate with each camera.
+ */
+static void benchmarkCameraRays(RayMarchKernel rayMarch, const int numRays)
+{
+    const int width = max(1, (int) rayMarch._formatWidth);
+    const int height = max(1, (int) rayMarch._formatHeight);
+    const char *cameras[] = {"pinhole", "depth of field", "latlong"};
+
+    std::vector<float4> cameraSamples(4096);
+    for (size_t index=0; index < cameraSamples.size(); index++)
+    {
+        const float3 seed = float3(index, 2 * index + 1, 0);
+        cameraSamples[index] = float4(
+            random(seed.x),
+            random(seed.y),
+            random(seed.x + seed.y),
+            random(seed.y - seed.x)
+        );
+    }
+
+    for (int camera=0; camera < 3; camera++)
+    {
+        rayMarch._depthOfFieldEnabled = camera == 1;
+        rayMarch._latLong = camera == 2;
+        rayMarch.init();
+
+        // Sum the rays so that none of them can be optimized away
+        float3 checksum = float3(0);
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int rayIndex=0; rayIndex < numRays; rayIndex++)
+        {
+            const int pixelIndex = rayIndex % (width * height);
+            float3 rayOrigin;
+            float3 rayDirection;
+            rayMarch.getCameraRay(
+                cameraSamples[rayIndex % cameraSamples.size()],
+                float2(pixelIndex % width, pixelIndex / width),
+                0,
+                rayOrigin,
+                rayDirection
+            );
+            checksum += rayOrigin + rayDirection;
+        }
+        const double seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start
+        ).count();
+
+        std::printf(
+            "%-15s %d rays in %.3fs: %.1f million rays/s (checksum %g)\n",
+            cameras[camera],
+            numRays,
+            seconds,
+            numRays / std::max(seconds, 1e-9) / 1e6,
+            checksum.x + checksum.y + checksum.z
+        );
+    }
+}
+
+
+/**
+ * Time fBm noise with 1 to 12 octaves, using the LUT simplex noise, and
+ * the table free simplex noise with its octaves evaluated one at a time
+ * and together in SIMD lanes, and print the time per evaluation of each.
+ * The positions are drawn up front, spread through a volume a few noise
+ * cells across, so that only the noise is timed.
+ *
+ * @arg rayMarch: The kernel with its params set, it is initialized to
+ *     fill the LUTs.
+ * @arg numEvaluations: The number of evaluations with each octave count
+ *     and noise.
+ */
+static void benchmarkNoise(RayMarchKernel rayMarch, const int numEvaluations)
+{
+    rayMarch.init();
+
+    std::vector<float4> positions(4096);
+    for (size_t index=0; index < positions.size(); index++)
+    {
+        const float3 seed = float3(index, 2 * index + 1, 0);
+        positions[index] = 8.0f * float4(
+            random(seed.x),
+            random(seed.y),
+            random(seed.x + seed.y),
+            0.0f
+        );
+    }
+
+    const float4 unitScale = float4(1.0f);
+    const float4 noTranslation = float4(0.0f);
+    const char *noises[] = {"LUT", "table free", "SIMD"};
+    std::printf("SIMD noise uses %s\n", simdNoiseInstructions());
+
+    for (int octaves=1; octaves <= 12; octaves++)
+    {
+        double nanoseconds[3];
+        float checksum = 0.0f;
+        for (int noise=0; noise < 3; noise++)
+        {
+            simdNoiseEnabled() = noise == 2;
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (int evaluation=0; evaluation < numEvaluations; evaluation++)
+            {
+                const float4 &position = positions[evaluation % positions.size()];
+                checksum += noise == 0 ? fractalBrownianMotionNoise(
+                    (float) octaves,
+                    2.0f,
+                    1.0f,
+                    0.5f,
+                    1.0f,
+                    position,
+                    unitScale,
+                    unitScale,
+                    noTranslation,
+                    noTranslation,
+                    rayMarch.__simplex,
+                    rayMarch.__perm,
+                    rayMarch.__grad4,
+                    0.0f
+                ) : fractalBrownianMotionNoise(
+                    (float) octaves,
+                    2.0f,
+                    1.0f,
+                    0.5f,
+                    1.0f,
+                    position,
+                    unitScale,
+                    unitScale,
+                    noTranslation,
+                    noTranslation,
+                    0.0f
+                );
+            }
+            nanoseconds[noise] = 1e9 * std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start
+            ).count() / numEvaluations;
+        }
+        simdNoiseEnabled() = true;
+
+        std::printf(
+            "%2d octaves: %s %.0f ns, %s %.0f ns, %s %.0f ns per evaluation (checksum %g)\n",
+            octaves,
+            noises[0],
+            nanoseconds[0],
+            noises[1],
+            nanoseconds[1],
+            noises[2],
+            nanoseconds[2],
+            checksum
+        );
+    }
+}
+
+
+/**
+ * Time the variance of a noisy image computed directly, and in the
+ * separable passes, with windows from 1 up to a range, doubling, and
+ * print the time of each and how far apart their results are. The image
+ * has a wide range of values, like a render, so the difference shows
+ * the rounding of the merged rows.
+ *
+ * @arg maxRange: The largest number of pixels either side of the centre
+ *     of the window.
+ * @arg width: The width of the image.
+ * @arg height: The height of the image.
+ */
+static void benchmarkVariance(const int maxRange, const int width, const int height)
+{
+    ImageBuffer src;
+    src.resize(width, height);
+    for (size_t index=0; index < src.pixels.size(); index++)
+    {
+        const float3 seed = float3(index, 2 * index + 1, 0);
+        const float brightness = exp(8.0f * random(seed.x) - 4.0f);
+        src.pixels[index] = brightness * float4(
+            random(seed.y),
+            random(seed.x + seed.y),
+            random(seed.y - seed.x),
+            1.0f
+        );
+    }
+
+    ImageBuffer direct;
+    ImageBuffer rowMeans;
+    ImageBuffer rowSquaredDeviations;
+    ImageBuffer separable;
+    for (int range=1; range <= maxRange; range *= 2)
+    {
+        const float2 windowRange = float2(range, range);
+
+        const std::chrono::steady_clock::time_point directStart = std::chrono::steady_clock::now();
+        runVariance(src, rowMeans, rowSquaredDeviations, windowRange, false, direct);
+        const double directSeconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - directStart
+        ).count();
+
+        const std::chrono::steady_clock::time_point separableStart = std::chrono::steady_clock::now();
+        runVarianceRows(src, (float) range, false, rowMeans);
+        runVarianceRows(src, (float) range, true, rowSquaredDeviations);
+        runVariance(src, rowMeans, rowSquaredDeviations, windowRange, true, separable);
+        const double separableSeconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - separableStart
+        ).count();
+
+        float maxDifference = 0.0f;
+        for (size_t index=0; index < direct.pixels.size(); index++)
+        {
+            const float4 &expected = direct.pixels[index];
+            const float4 &actual = separable.pixels[index];
+            for (int channel=0; channel < 3; channel++)
+            {
+                maxDifference = max(
+                    maxDifference,
+                    fabs(actual[channel] - expected[channel])
+                    / max(fabs(expected[channel]), FLT_MIN)
+                );
+            }
+        }
+
+        std::printf(
+            "range %2d (%dx%d window): direct %.3fs, separable %.3fs, %.1fx, max relative difference %g\n",
+            range,
+            2 * range + 1,
+            2 * range + 1,
+            directSeconds,
+            separableSeconds,
+            directSeconds / std::max(separableSeconds, 1e-9),
+            maxDifference
+        );
+    }
+}
+
+
+/**
+ * Check that the moments AOV encoding gives back the mean and variance
+ * it was given, to within the precision of a half float, including the
+ * means that are zero, too small for a half float, or clamped to the
+ * largest one, and print the cases that do not.
+ *
+ * @returns: Whether every case round tripped.
+ */
+static bool checkMoments()
+{
+    const float cases[][2] = {
+        {0.5f, 0.01f},
+        {300.0f, 1.0f},
+        {1000.0f, 5e6f},
+        {-3.0f, 2.0f},
+        {0.0f, 0.0f},
+        {0.0f, 4.0f},
+        {1e-6f, 1e-2f},
+        {-1e-6f, 9.0f},
+        {1e-4f, 1e4f},
+        {2.0f, 0.0f},
+        {70000.0f, 1e6f},
+        {1e6f, 1e18f},
+    };
+
+    int failures = 0;
+    for (const float *moments : cases)
+    {
+        const float mean = moments[0];
+        const float variance = moments[1];
+        const float encoded = encodeMoments(mean, variance);
+        const float2 decoded = decodeMoments(encoded);
+
+        // The mean is clamped to the largest half float, and a variance
+        // of zero is rounded up to the smallest normal deviation
+        const float expectedMean = clamp(mean, -MAX_HALF, MAX_HALF);
+        const float smallestDeviation = 1.01f * MIN_NORMAL_HALF * max(1.0f, fabs(expectedMean));
+        const bool meanMatches = (
+            fabs(decoded.x - expectedMean) <= 1e-3f * fabs(expectedMean) + 1e-7f
+        );
+        const bool varianceMatches = (
+            variance == 0.0f
+            ? decoded.y <= smallestDeviation * smallestDeviation
+            : fabs(decoded.y - variance) <= 5e-3f * variance
+        );
+        if (!std::isnormal(encoded) || !meanMatches || !varianceMatches)
+        {
+            std::printf(
+                "moments of mean %g and variance %g decoded as %g and %g\n",
+                mean,
+                variance,
+                decoded.x,
+                decoded.y
+            );
+            failures++;
+        }
+    }
+    std::printf(
+        "moments: %d of %zu round trips failed\n",
+        failures,
+        sizeof(cases) / sizeof(cases[0])
+    );
+    return failures == 0;
+}
+
+
+/**
+ * Check that the SIMD table free noise matches the scalar noise, to
+ * within the rounding of a compiler that fuses the multiplies and adds
+ * differently, for single evaluations of every batch size, and for fBm
+ * with 1 to 12 octaves, filtered and not, and print the largest errors.
+ *
+ * @returns: Whether the errors are within the tolerance.
+ */
+static bool checkNoise()
+{
+    // The seeds reach 500, where a float only resolves about 3e-5
+    const float tolerance = 1e-4f;
+
+    // Spread the seeds over negative and positive cells, far from the
+    // origin, where the hashes of the lattice overflow
+    std::vector<float4> seeds(4099);
+    for (size_t index=0; index < seeds.size(); index++)
+    {
+        const float3 seed = float3(index, 2 * index + 1, 3 * index + 2);
+        seeds[index] = 1000.0f * float4(
+            random(seed.x) - 0.5f,
+            random(seed.y) - 0.5f,
+            random(seed.z) - 0.5f,
+            random(seed.x + seed.y) - 0.5f
+        ) / float(1 + index % 100);
+    }
+
+    std::vector<float> x(seeds.size());
+    std::vector<float> y(seeds.size());
+    std::vector<float> z(seeds.size());
+    std::vector<float> w(seeds.size());
+    for (size_t index=0; index < seeds.size(); index++)
+    {
+        x[index] = seeds[index].x;
+        y[index] = seeds[index].y;
+        z[index] = seeds[index].z;
+        w[index] = seeds[index].w;
+    }
+
+    // Every count up to a batch, then the rest at once, so that the
+    // partly filled registers are checked too
+    std::vector<float> noise(seeds.size());
+    size_t first = 0;
+    for (int count=1; count <= SIMD_NOISE_BATCH; count++)
+    {
+        simdPerlinSimplexNoise(&x[first], &y[first], &z[first], &w[first], count, &noise[first]);
+        first += count;
+    }
+    simdPerlinSimplexNoise(
+        &x[first],
+        &y[first],
+        &z[first],
+        &w[first],
+        (int) (seeds.size() - first),
+        &noise[first]
+    );
+
+    float noiseError = 0.0f;
+    for (size_t index=0; index < seeds.size(); index++)
+    {
+        noiseError = max(noiseError, fabs(noise[index] - perlinSimplexNoise(seeds[index])));
+    }
+
+    float fbmError = 0.0f;
+    const float4 lowFrequencyScale = float4(1.0f, 0.5f, 2.0f, 1.0f);
+    const float4 highFrequencyScale = float4(3.0f, 1.0f, 0.25f, 1.0f);
+    const float4 lowFrequencyTranslation = float4(0.0f);
+    const float4 highFrequencyTranslation = float4(10.0f, -5.0f, 2.0f, 0.5f);
+    for (int octaves=1; octaves <= 12; octaves++)
+    {
+        for (size_t index=0; index < seeds.size(); index += 7)
+        {
+            // Filtering culls the finer octaves of the distant seeds
+            const float filterWidth = index % 2 == 0 ? 0.0f : 0.01f * (index % 50);
+            float values[2];
+            for (int simd=0; simd < 2; simd++)
+            {
+                simdNoiseEnabled() = simd == 1;
+                values[simd] = fractalBrownianMotionNoise(
+                    (float) octaves,
+                    2.0f,
+                    4.0f,
+                    0.5f,
+                    1.0f,
+                    seeds[index] * 0.01f,
+                    lowFrequencyScale,
+                    highFrequencyScale,
+                    lowFrequencyTranslation,
+                    highFrequencyTranslation,
+                    filterWidth
+                );
+            }
+            fbmError = max(fbmError, fabs(values[1] - values[0]));
+        }
+    }
+    simdNoiseEnabled() = true;
+
+    std::printf(
+        "noise: %s noise differs by at most %g, and its fBm by %g\n",
+        simdNoiseInstructions(),
+        noiseError,
+        fbmError
+    );
+    return noiseError <= tolerance && fbmError <= tolerance;
+}
+
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (options.selfCheck)
+    {
+        const bool momentsMatch = checkMoments();
+        const bool noiseMatches = checkNoise();
+        return momentsMatch && noiseMatches ? 0 : 1;
+    }
+    if (options.benchmarkVariance > 0)
+    {
+        benchmarkVariance(
+            options.benchmarkVariance,
+            options.width > 0 ? options.width : 1024,
+            options.height > 0 ? options.height : 778
+        );
+        return 0;
+    }
+
+    std::string error;
+    Scene scene;
+    if (!readScene(options.scenePath, scene, error))
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    RayMarchKernel rayMarch;
+    KernelParams params;
+    rayMarch.blinkParams = &params;
+    rayMarch.define();
+    rayMarch.blinkParams = nullptr;
+
+    scene.params.insert(scene.params.end(), options.params.begin(), options.params.end());
+    for (const std::pair<std::string, std::string> &assignment : scene.params)
+    {
+        if (!setParam(params, assignment.first, assignment.second, error))
+        {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+    }
+
+    // Without a noise input there is nothing to read the seeds from
+    if (!scene.images.count("noise"))
+    {
+        rayMarch._generateSeeds = true;
+        rayMarch._blueNoiseSeeds = false;
+    }
+
+    const int width = options.width > 0 ? options.width : (int) rayMarch._formatWidth;
+    const int height = options.height > 0 ? options.height : (int) rayMarch._formatHeight;
+
+    ImageBuffer empty;
+    bindInputs(scene, empty, rayMarch);
+    if (options.benchmarkRays > 0)
+    {
+        benchmarkCameraRays(rayMarch, options.benchmarkRays);
+        return 0;
+    }
+    if (options.benchmarkNoise > 0)
+    {
+        benchmarkNoise(rayMarch, options.benchmarkNoise);
+        return 0;
+    }
+    rayMarch.init();
+
+    std::unique_ptr<TileWriter> writer = createTileWriter(options.outputPath);
+    if (!writer->open(options.outputPath, width, height))
+    {
+        std::fprintf(stderr, "cannot write %s\n", options.outputPath.c_str());
+        return 1;
+    }
+
+    const std::vector<Tile> tiles = makeTiles(width, height, options.tileSize, options.tileOrder);
+    const int numThreads = max(
+        1,
+        options.numThreads > 0 ? options.numThreads : (int) std::thread::hardware_concurrency()
+    );
+
+    std::mutex outputMutex;
+    std::vector<TileStats> tileStats(tiles.size());
+    std::vector<ThreadStats> threadStats(numThreads);
+    TileScheduler scheduler((int) tiles.size(), numThreads);
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Every thread takes tiles until there are none left, rendering them
+    // with its own copy of the kernel into a buffer the size of a tile
+    std::vector<std::thread> threads;
+    for (int threadIndex=0; threadIndex < numThreads; threadIndex++)
+    {
+        threads.push_back(std::thread([&, threadIndex]()
+        {
+            RayMarchKernel threadRayMarch = rayMarch;
+            ImageBuffer output;
+            ThreadStats &thread = threadStats[threadIndex];
+            int index;
+            bool stolen;
+            while (scheduler.nextTile(threadIndex, index, stolen))
+            {
+                const Tile &tile = tiles[index];
+                const TileStats stats = renderTile(threadRayMarch, tile, options, output);
+                tileStats[index] = stats;
+                thread.busySeconds += stats.seconds;
+                thread.tiles++;
+                thread.stolenTiles += stolen;
+
+                std::lock_guard<std::mutex> lock(outputMutex);
+                writer->writeTile(output);
+                if (!options.quiet)
+                {
+                    std::printf(
+                        "tile %d at (%d, %d) %dx%d on thread %d%s: %.3fs, %.0f paths, %.0f to %.0f per pixel\n",
+                        tile.index,
+                        tile.x,
+                        tile.y,
+                        tile.width,
+                        tile.height,
+                        threadIndex,
+                        stolen ? " (stolen)" : "",
+                        stats.seconds,
+                        stats.paths,
+                        stats.paths > 0.0 ? stats.minPaths : 0.0f,
+                        stats.maxPaths
+                    );
+                    std::fflush(stdout);
+                }
+            }
+        }));
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    const double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+
+    double totalPaths = 0.0;
+    double slowestTile = 0.0;
+    PacketStats packetStats;
+    for (const TileStats &stats : tileStats)
+    {
+        totalPaths += stats.paths;
+        slowestTile = std::max(slowestTile, stats.seconds);
+        packetStats += stats.packets;
+    }
+    std::printf(
+        "%dx%d in %zu tiles on %d threads: %.3fs, slowest tile %.3fs, %.0f paths, %.0f camera rays/s\n",
+        width,
+        height,
+        tiles.size(),
+        numThreads,
+        seconds,
+        slowestTile,
+        totalPaths,
+        totalPaths / std::max(seconds, 1e-9)
+    );
+
+    // The time the threads spent rendering, out of the time the frame
+    // took, the rest they were idle, or waiting on the output file
+    double busySeconds = 0.0;
+    double leastBusySeconds = DBL_MAX;
+    int stolenTiles = 0;
+    for (const ThreadStats &stats : threadStats)
+    {
+        busySeconds += stats.busySeconds;
+        leastBusySeconds = std::min(leastBusySeconds, stats.busySeconds);
+        stolenTiles += stats.stolenTiles;
+    }
+    std::printf(
+        "threads busy %.1f%% of the frame, the least busy %.1f%%, %d tiles stolen\n",
+        100.0 * busySeconds / (numThreads * std::max(seconds, 1e-9)),
+        100.0 * leastBusySeconds / std::max(seconds, 1e-9),
+        stolenTiles
+    );
+    if (packetStats.pixels > 0.0)
+    {
+        std::printf(
+            "%.0f packets: %.1f distance evaluations per packet, %.1f per pixel, %.3f skipped per pixel\n",
+            packetStats.packets,
+            packetStats.packetSteps / packetStats.packets,
+            packetStats.pixelSteps / packetStats.pixels,
+            packetStats.distanceSkipped / packetStats.pixels
+        );
+    }
+
+    if (!writer->close())
+    {
+        std::fprintf(stderr, "cannot write %s\n", options.outputPath.c_str());
+        return 1;
+    }
+    return 0;
+}
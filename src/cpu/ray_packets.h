@@ -0,0 +1,382 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+//
+// Packets of camera rays for the CPU renderer
+//
+// Every path of a pixel sphere traces its camera ray all the way from the
+// camera, and neighbouring pixels pass the same objects for most of that
+// march. Here the pixels are grouped into packets of eight, a 4x2 block
+// in Morton order, and a single cone enclosing the rays of the whole
+// packet is marched with one distance evaluation per step (cone marching,
+// Drobot 2009). Once the cone gets too wide for the space around it the
+// packet has diverged, and every pixel carries on alone with the cone
+// around its own footprint, until that touches a surface. Every path of
+// the pixel then starts its march from there.
+//
+// The distance functions of the kernel evaluate a single point, so the
+// lanes of a packet share the distance evaluations rather than making
+// them in SIMD, only the lane arithmetic is laid out to vectorize.
+//
+
+#pragma once
+
+#include <cmath>
+
+#include "blink.h"
+
+
+#define PACKET_WIDTH 8
+
+// A pixel spans its camera rays with the rays through its corners
+#define PIXEL_CORNERS 4
+
+// Widen the cones slightly, so that rounding cannot leave a ray outside
+#define CONE_SPREAD_MARGIN 1.001f
+
+
+// A value for every lane of a packet
+struct FloatPack
+{
+    float lane[PACKET_WIDTH];
+};
+
+struct IntPack
+{
+    int lane[PACKET_WIDTH];
+};
+
+
+// A vector for every lane of a packet, by component
+struct Float3Pack
+{
+    FloatPack x;
+    FloatPack y;
+    FloatPack z;
+};
+
+
+// What marching the packets cost, and saved
+struct PacketStats
+{
+    double packets = 0.0;
+    double pixels = 0.0;
+    double packetSteps = 0.0; // distance evaluations for whole packets
+    double pixelSteps = 0.0; // distance evaluations for single pixels
+    double distanceSkipped = 0.0; // summed over the pixels
+
+    void operator+=(const PacketStats &other)
+    {
+        packets += other.packets;
+        pixels += other.pixels;
+        packetSteps += other.packetSteps;
+        pixelSteps += other.pixelSteps;
+        distanceSkipped += other.distanceSkipped;
+    }
+};
+
+
+/**
+ * Check whether a kernel traces camera rays that all leave from one
+ * point, into a scene that stays still, and can therefore be bundled
+ * into cones.
+ */
+template<class Kernel>
+inline bool packetsSupported(const Kernel &kernel)
+{
+    return (
+        !kernel._latLong
+        && !kernel._depthOfFieldEnabled
+        && !kernel._motionBlur
+        && kernel._outputType != NOISE_VOLUME_AOV
+    );
+}
+
+
+/**
+ * Get the view whose rays an output pixel traces, the views are stacked
+ * from the top, each as tall as the format.
+ *
+ * @returns: The index of the view from the left, or -1 for the pixels
+ *     beyond the last view.
+ */
+template<class Kernel>
+inline int pixelView(const Kernel &kernel, const int2 &pos)
+{
+    if (kernel._numViews <= 1)
+    {
+        return 0;
+    }
+    const int height = max(1, (int) kernel._formatHeight);
+    const int view = kernel._numViews - 1 - pos.y / height;
+    return view < 0 ? -1 : view;
+}
+
+
+/**
+ * Get the pixel of the format whose rays an output pixel traces, the
+ * AOV layers, and cryptomatte, lay copies of the format side by side,
+ * and the views stack copies of them.
+ */
+template<class Kernel>
+inline int2 formatPixel(const Kernel &kernel, const int2 &pos)
+{
+    int2 pixel = pos;
+    if (
+        kernel._outputType == AOV_LAYERS_AOV
+        || kernel._outputType == CRYPTOMATTE_AOV
+    ) {
+        const int width = max(1, (int) kernel._formatWidth);
+        pixel.x = ((pos.x % width) + width) % width;
+    }
+    if (kernel._numViews > 1)
+    {
+        const int height = max(1, (int) kernel._formatHeight);
+        pixel.y = ((pos.y % height) + height) % height;
+    }
+    return pixel;
+}
+
+
+/**
+ * Get the tangent of the half angle of a cone around an axis that
+ * encloses a set of directions.
+ *
+ * @arg axis: The normalized axis of the cone.
+ * @arg directions: The normalized directions to enclose.
+ *
+ * @returns: The tangent of the half angle of the cone, for every lane.
+ */
+inline FloatPack coneSpread(const Float3Pack &axis, const Float3Pack directions[PIXEL_CORNERS])
+{
+    FloatPack minCosine;
+    for (int lane=0; lane < PACKET_WIDTH; lane++)
+    {
+        minCosine.lane[lane] = 1.0f;
+    }
+    for (int corner=0; corner < PIXEL_CORNERS; corner++)
+    {
+        for (int lane=0; lane < PACKET_WIDTH; lane++)
+        {
+            minCosine.lane[lane] = min(
+                minCosine.lane[lane],
+                axis.x.lane[lane] * directions[corner].x.lane[lane]
+                + axis.y.lane[lane] * directions[corner].y.lane[lane]
+                + axis.z.lane[lane] * directions[corner].z.lane[lane]
+            );
+        }
+    }
+
+    FloatPack spread;
+    for (int lane=0; lane < PACKET_WIDTH; lane++)
+    {
+        const float cosine = max(minCosine.lane[lane], 1e-6f);
+        spread.lane[lane] = CONE_SPREAD_MARGIN * std::sqrt(
+            max(0.0f, 1.0f - cosine * cosine)
+        ) / cosine;
+    }
+    return spread;
+}
+
+
+/**
+ * March a cone out of the camera, as far as it stays clear of every
+ * surface.
+ *
+ * @arg kernel: The initialized kernel.
+ * @arg origin: The position of the camera.
+ * @arg axis: The normalized axis of the cone.
+ * @arg spread: The tangent of the half angle of the cone.
+ * @arg distance: The distance along the axis that is already known to
+ *     be clear.
+ * @arg maxCoverage: Stop once the radius of the cone is more than this
+ *     fraction of the distance to the nearest surface.
+ * @arg steps: The location to count the distance evaluations in.
+ *
+ * @returns: The distance along the axis up to which the cone is clear.
+ */
+template<class Kernel>
+float marchCone(
+        Kernel &kernel,
+        const float3 &origin,
+        const float3 &axis,
+        const float spread,
+        float distance,
+        const float maxCoverage,
+        double &steps)
+{
+    for (int iteration=0; iteration < kernel._maxRaySteps; iteration++)
+    {
+        // Stop where the rays would be close enough to count as a hit,
+        // their footprint grows as the kernel marches them
+        const float footprint = kernel.rayFootprint(distance);
+        const float surfaceDistance = kernel.getMinDistanceToObjectInScene(
+            origin + distance * axis,
+            footprint,
+            0.0f,
+            true
+        );
+        steps++;
+
+        // A sphere of that radius is clear, and so is the slice of the
+        // cone inside it
+        const float radius = distance * spread;
+        const float stepDistance = (surfaceDistance - radius) / (1.0f + spread);
+        if (
+            radius > maxCoverage * surfaceDistance
+            || stepDistance < footprint
+            || distance + stepDistance >= kernel._maxRayDistance
+        ) {
+            break;
+        }
+        distance += stepDistance;
+    }
+    return distance;
+}
+
+
+/**
+ * Find how far every path of the pixels of a packet can skip along its
+ * camera ray without passing a surface.
+ *
+ * @arg kernel: The initialized kernel.
+ * @arg pixels: The pixels of the format in each lane, inactive lanes
+ *     must repeat an active pixel.
+ * @arg view: The view that every lane traces.
+ * @arg activeLanes: A bit for every lane that holds a pixel to render.
+ * @arg maxCoverage: The fraction of the distance to the nearest surface
+ *     the cone of the packet can cover, before the packet splits into
+ *     its pixels.
+ * @arg starts: The location to store the distance for every lane.
+ * @arg startSteps: The location to store the distance evaluations that
+ *     cleared the start of every lane, those of the packet cone and of
+ *     the cone of its pixel.
+ * @arg stats: The location to add the cost to.
+ */
+template<class Kernel>
+void marchPacket(
+        Kernel &kernel,
+        const int2 pixels[PACKET_WIDTH],
+        const int view,
+        const unsigned int activeLanes,
+        const float maxCoverage,
+        FloatPack &starts,
+        IntPack &startSteps,
+        PacketStats &stats)
+{
+    float3 origin;
+    Float3Pack corners[PIXEL_CORNERS];
+    for (int lane=0; lane < PACKET_WIDTH; lane++)
+    {
+        for (int corner=0; corner < PIXEL_CORNERS; corner++)
+        {
+            float3 direction;
+            kernel.getCameraRay(
+                float4(corner & 1, corner >> 1, 0, 0),
+                float2(pixels[lane].x, pixels[lane].y),
+                view,
+                origin,
+                direction
+            );
+            corners[corner].x.lane[lane] = direction.x;
+            corners[corner].y.lane[lane] = direction.y;
+            corners[corner].z.lane[lane] = direction.z;
+        }
+    }
+
+    // The cone around every pixel, and the one around the whole packet
+    Float3Pack pixelAxes = corners[0];
+    for (int corner=1; corner < PIXEL_CORNERS; corner++)
+    {
+        for (int lane=0; lane < PACKET_WIDTH; lane++)
+        {
+            pixelAxes.x.lane[lane] += corners[corner].x.lane[lane];
+            pixelAxes.y.lane[lane] += corners[corner].y.lane[lane];
+            pixelAxes.z.lane[lane] += corners[corner].z.lane[lane];
+        }
+    }
+    float3 packetAxis = float3(0);
+    for (int lane=0; lane < PACKET_WIDTH; lane++)
+    {
+        const float norm = std::sqrt(
+            pixelAxes.x.lane[lane] * pixelAxes.x.lane[lane]
+            + pixelAxes.y.lane[lane] * pixelAxes.y.lane[lane]
+            + pixelAxes.z.lane[lane] * pixelAxes.z.lane[lane]
+        );
+        pixelAxes.x.lane[lane] /= norm;
+        pixelAxes.y.lane[lane] /= norm;
+        pixelAxes.z.lane[lane] /= norm;
+        packetAxis += float3(
+            pixelAxes.x.lane[lane],
+            pixelAxes.y.lane[lane],
+            pixelAxes.z.lane[lane]
+        );
+    }
+    packetAxis = normalize(packetAxis);
+
+    Float3Pack packetAxes;
+    for (int lane=0; lane < PACKET_WIDTH; lane++)
+    {
+        packetAxes.x.lane[lane] = packetAxis.x;
+        packetAxes.y.lane[lane] = packetAxis.y;
+        packetAxes.z.lane[lane] = packetAxis.z;
+    }
+    const FloatPack pixelSpreads = coneSpread(pixelAxes, corners);
+    const FloatPack packetSpreads = coneSpread(packetAxes, corners);
+    float packetSpread = 0.0f;
+    for (int lane=0; lane < PACKET_WIDTH; lane++)
+    {
+        packetSpread = max(packetSpread, packetSpreads.lane[lane]);
+    }
+
+    double packetSteps = 0.0;
+    const float packetDistance = marchCone(
+        kernel,
+        origin,
+        packetAxis,
+        packetSpread,
+        0.0f,
+        maxCoverage,
+        packetSteps
+    );
+    stats.packetSteps += packetSteps;
+
+    for (int lane=0; lane < PACKET_WIDTH; lane++)
+    {
+        if (!(activeLanes & (1u << lane)))
+        {
+            starts.lane[lane] = 0.0f;
+            startSteps.lane[lane] = 0;
+            continue;
+        }
+
+        // A ray is clear as far along itself as along the axis of a cone
+        // around it, the cone of the pixel can only resume from the
+        // part of itself that lies inside the clear part of the packet
+        const float3 pixelAxis = float3(
+            pixelAxes.x.lane[lane],
+            pixelAxes.y.lane[lane],
+            pixelAxes.z.lane[lane]
+        );
+        const float pixelSpread = pixelSpreads.lane[lane];
+        double pixelSteps = 0.0;
+        const float pixelDistance = marchCone(
+            kernel,
+            origin,
+            pixelAxis,
+            pixelSpread,
+            packetDistance / std::sqrt(1.0f + pixelSpread * pixelSpread),
+            1.0f,
+            pixelSteps
+        );
+        stats.pixelSteps += pixelSteps;
+        starts.lane[lane] = max(packetDistance, pixelDistance);
+        startSteps.lane[lane] = (int) (packetSteps + pixelSteps);
+        stats.pixels++;
+        stats.distanceSkipped += starts.lane[lane];
+    }
+    stats.packets++;
+}
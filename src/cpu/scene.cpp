@@ -0,0 +1,230 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+#include "scene.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "image_io.h"
+
+
+/**
+ * Remove the whitespace from both ends of some text.
+ */
+static std::string trim(const std::string &text)
+{
+    const size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos)
+    {
+        return "";
+    }
+    const size_t last = text.find_last_not_of(" \t\r\n");
+    return text.substr(first, last - first + 1);
+}
+
+
+/**
+ * Get the directory a file is in, with a trailing slash, or nothing if
+ * it is in the working directory.
+ */
+static std::string directoryOf(const std::string &path)
+{
+    const size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+
+bool readScene(const std::string &path, Scene &scene, std::string &error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        line = trim(line);
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        const std::string location = path + ":" + std::to_string(lineNumber) + ": ";
+        if (line.compare(0, 6, "image ") == 0)
+        {
+            std::istringstream words(line.substr(6));
+            std::string name;
+            std::string source;
+            words >> name >> source;
+
+            ImageBuffer &image = scene.images[name];
+            int width;
+            int height;
+            std::istringstream size(source);
+            if (!(size >> width) || !(words >> height))
+            {
+                if (!readImage(directoryOf(path) + source, image))
+                {
+                    error = location + "cannot read the image " + source;
+                    return false;
+                }
+                continue;
+            }
+
+            image.resize(width, height);
+            for (float4 &pixel : image.pixels)
+            {
+                std::string pixelLine;
+                do
+                {
+                    lineNumber++;
+                    if (!std::getline(file, pixelLine))
+                    {
+                        error = path + ": the image " + name + " is missing pixels";
+                        return false;
+                    }
+                    pixelLine = trim(pixelLine);
+                }
+                while (pixelLine.empty() || pixelLine[0] == '#');
+
+                std::istringstream values(pixelLine);
+                if (!(values >> pixel.x >> pixel.y >> pixel.z >> pixel.w))
+                {
+                    error = path + ":" + std::to_string(lineNumber) + ": expected four values";
+                    return false;
+                }
+            }
+            continue;
+        }
+
+        const size_t equals = line.find('=');
+        if (equals == std::string::npos)
+        {
+            error = location + "expected 'label = values' or 'image name ...'";
+            return false;
+        }
+        scene.params.push_back(std::make_pair(
+            trim(line.substr(0, equals)),
+            trim(line.substr(equals + 1))
+        ));
+    }
+    return true;
+}
+
+
+/**
+ * Read a number of floats from some text.
+ *
+ * @returns: Whether there were exactly that many.
+ */
+static bool readFloats(const std::string &text, float *values, const int count)
+{
+    std::istringstream stream(text);
+    for (int index=0; index < count; index++)
+    {
+        if (!(stream >> values[index]))
+        {
+            return false;
+        }
+    }
+    std::string extra;
+    return !(stream >> extra);
+}
+
+
+bool setParam(
+        const KernelParams &params,
+        const std::string &label,
+        const std::string &values,
+        std::string &error)
+{
+    const KernelParams::const_iterator found = params.find(label);
+    if (found == params.end())
+    {
+        error = "there is no parameter labelled '" + label + "'";
+        return false;
+    }
+
+    const KernelParam &param = found->second;
+    float parsed[16];
+    bool valid = true;
+    switch (param.type)
+    {
+        case eParamBool:
+            if (values == "true" || values == "false")
+            {
+                *static_cast<bool *>(param.value) = values == "true";
+            }
+            else if ((valid = readFloats(values, parsed, 1)))
+            {
+                *static_cast<bool *>(param.value) = parsed[0] != 0.0f;
+            }
+            break;
+        case eParamInt:
+            if ((valid = readFloats(values, parsed, 1)))
+            {
+                *static_cast<int *>(param.value) = (int) parsed[0];
+            }
+            break;
+        case eParamInt2:
+            if ((valid = readFloats(values, parsed, 2)))
+            {
+                *static_cast<int2 *>(param.value) = int2((int) parsed[0], (int) parsed[1]);
+            }
+            break;
+        case eParamFloat:
+            if ((valid = readFloats(values, parsed, 1)))
+            {
+                *static_cast<float *>(param.value) = parsed[0];
+            }
+            break;
+        case eParamFloat2:
+            if ((valid = readFloats(values, parsed, 2)))
+            {
+                *static_cast<float2 *>(param.value) = float2(parsed[0], parsed[1]);
+            }
+            break;
+        case eParamFloat3:
+            if ((valid = readFloats(values, parsed, 3)))
+            {
+                *static_cast<float3 *>(param.value) = float3(parsed[0], parsed[1], parsed[2]);
+            }
+            break;
+        case eParamFloat4:
+            if ((valid = readFloats(values, parsed, 4)))
+            {
+                *static_cast<float4 *>(param.value) = float4(
+                    parsed[0],
+                    parsed[1],
+                    parsed[2],
+                    parsed[3]
+                );
+            }
+            break;
+        case eParamFloat4x4:
+            if ((valid = readFloats(values, parsed, 16)))
+            {
+                float4x4 &matrix = *static_cast<float4x4 *>(param.value);
+                for (int index=0; index < 16; index++)
+                {
+                    matrix[index / 4][index % 4] = parsed[index];
+                }
+            }
+            break;
+    }
+
+    if (!valid)
+    {
+        error = "cannot set '" + label + "' to '" + values + "'";
+    }
+    return valid;
+}
@@ -0,0 +1,73 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+//
+// Scene files for the CPU renderer
+//
+// A scene file sets the parameters of the kernel by the labels they have
+// on the BlinkScript node, and fills its inputs, one per line:
+//
+//     # a comment
+//     Max Paths Per Pixel = 16
+//     Camera World Matrix = 1 0 0 0  0 1 0 0  0 0 1 0  0 0 0 1
+//     image hdri sky.exr
+//     image positions 2 1
+//     0 -1 -5 1
+//     0 0 -5 1
+//
+// An image either names an EXR, or PFM, file, relative to the scene
+// file, or gives its width and height followed by one line of four values
+// per pixel, from the bottom left, row by row.
+//
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "blink.h"
+
+
+struct Scene
+{
+    // The parameter labels and values, in the order they were given
+    std::vector<std::pair<std::string, std::string>> params;
+
+    // The images, by the name of the kernel input they are bound to
+    std::map<std::string, ImageBuffer> images;
+};
+
+
+/**
+ * Read a scene file.
+ *
+ * @arg path: The file to read.
+ * @arg scene: The location to store the scene.
+ * @arg error: The location to store what went wrong.
+ *
+ * @returns: Whether the file was read.
+ */
+bool readScene(const std::string &path, Scene &scene, std::string &error);
+
+
+/**
+ * Set a parameter of a kernel from its values as text.
+ *
+ * @arg params: The parameters recorded by the 'define' of the kernel.
+ * @arg label: The label of the parameter.
+ * @arg values: The values, separated by whitespace, booleans are 0, 1,
+ *     'true', or 'false'.
+ * @arg error: The location to store what went wrong.
+ *
+ * @returns: Whether the parameter was set.
+ */
+bool setParam(
+        const KernelParams &params,
+        const std::string &label,
+        const std::string &values,
+        std::string &error);
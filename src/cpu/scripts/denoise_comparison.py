@@ -0,0 +1,285 @@
+# Copyright 2022 by Owen Bulka.
+# All rights reserved.
+# This file is released under the "MIT License Agreement".
+# Please see the LICENSE.md file that should have been included as part
+# of this package.
+"""Compare the denoiser to brute force paths at equal error.
+
+Renders each scene with the CPU renderer at a few paths per pixel, along
+with its 'normal', 'albedo', and 'depth' AOVs, and denoises it with
+chained 'Denoise' kernels. It then renders the scene without filtering,
+doubling the paths per pixel until the error matches that of the
+denoised render. The error is the RMSE against a reference with many
+more paths, rendered with another pass index so its noise is not
+shared. Prints the time and error of each render.
+
+    python3 src/cpu/scripts/denoise_comparison.py \\
+        build/ray_march_cpu build/denoise_cpu examples/*.scene \\
+        --set "Screen Width=240" --set "Screen Height=160"
+"""
+import argparse
+import math
+import os
+import re
+import struct
+import subprocess
+import tempfile
+
+
+# The output types of the renders the denoiser reads
+BEAUTY_AOV = 0
+NORMAL_AOV = 3
+DEPTH_AOV = 4
+ALBEDO_AOV = 10
+
+
+def read_pfm(path):
+    """Read the values of a PFM image.
+
+    Args:
+        path (str): The path to the image.
+
+    Returns:
+        list(float): The values of every channel of every pixel.
+    """
+    with open(path, "rb") as pfm_file:
+        pfm_file.readline()
+        pfm_file.readline()
+        scale = float(pfm_file.readline())
+        data = pfm_file.read()
+    byte_order = "<" if scale < 0 else ">"
+    return struct.unpack(
+        "{0}{1}f".format(byte_order, len(data) // 4),
+        data,
+    )
+
+
+def rmse(image, reference):
+    """Get the root mean squared error of an image.
+
+    Args:
+        image (list(float)): The values of the image.
+        reference (list(float)): The values of the reference.
+
+    Returns:
+        float: The error.
+    """
+    return math.sqrt(
+        sum((value - expected) ** 2 for value, expected in zip(image, reference))
+        / len(reference)
+    )
+
+
+def render(renderer, scene, output, output_type, paths, pass_index, extra_args):
+    """Render the scene and return the time the renderer reports.
+
+    Args:
+        renderer (str): The path to ray_march_cpu.
+        scene (str): The path to the scene file.
+        output (str): The PFM to write.
+        output_type (int): The AOV to render.
+        paths (int): The number of paths per pixel.
+        pass_index (int): The pass index to generate the seeds from.
+        extra_args (list(str)): Any more arguments for the renderer.
+
+    Returns:
+        float: The render time in seconds.
+    """
+    result = subprocess.run(
+        [
+            renderer,
+            scene,
+            output,
+            "--quiet",
+            "--set",
+            "Output Type={0}".format(output_type),
+            "--set",
+            "Min Paths Per Pixel={0}".format(paths),
+            "--set",
+            "Max Paths Per Pixel={0}".format(paths),
+            "--set",
+            "Pass Index={0}".format(pass_index),
+        ]
+        + extra_args,
+        check=True,
+        stdout=subprocess.PIPE,
+        universal_newlines=True,
+    )
+    match = re.search(r"threads: ([\d.]+)s", result.stdout)
+    return float(match.group(1))
+
+
+def denoise(denoiser, beauty, normal, albedo, depth, output, iterations):
+    """Denoise a render and return the time the denoiser reports.
+
+    Args:
+        denoiser (str): The path to denoise_cpu.
+        beauty (str): The PFM of the beauty.
+        normal (str): The PFM of the normal AOV.
+        albedo (str): The PFM of the albedo AOV.
+        depth (str): The PFM of the depth AOV.
+        output (str): The PFM to write.
+        iterations (int): The number of chained iterations.
+
+    Returns:
+        float: The filtering time in seconds.
+    """
+    result = subprocess.run(
+        [
+            denoiser,
+            beauty,
+            normal,
+            albedo,
+            depth,
+            output,
+            "--iterations",
+            str(iterations),
+        ],
+        check=True,
+        stdout=subprocess.PIPE,
+        universal_newlines=True,
+    )
+    match = re.search(r"iterations: ([\d.]+)s", result.stdout)
+    return float(match.group(1))
+
+
+def compare(args, scene, renderer_args):
+    """Compare the denoiser to brute force paths on one scene.
+
+    Args:
+        args (argparse.Namespace): The parsed arguments.
+        scene (str): The path to the scene file.
+        renderer_args (list(str)): Any more arguments for the renderer.
+    """
+    directory = tempfile.mkdtemp()
+
+    def path(name):
+        return os.path.join(directory, name + ".pfm")
+
+    render(
+        args.renderer,
+        scene,
+        path("reference"),
+        BEAUTY_AOV,
+        args.reference_paths,
+        1,
+        renderer_args,
+    )
+    reference = read_pfm(path("reference"))
+
+    # The features only need the first hit, but are averaged over the
+    # same paths as the beauty so their edges are anti-aliased alike
+    seconds = 0.0
+    for name, output_type in (
+        ("beauty", BEAUTY_AOV),
+        ("normal", NORMAL_AOV),
+        ("albedo", ALBEDO_AOV),
+        ("depth", DEPTH_AOV),
+    ):
+        seconds += render(
+            args.renderer,
+            scene,
+            path(name),
+            output_type,
+            args.paths,
+            0,
+            renderer_args,
+        )
+    filter_seconds = denoise(
+        args.denoiser,
+        path("beauty"),
+        path("normal"),
+        path("albedo"),
+        path("depth"),
+        path("denoised"),
+        args.iterations,
+    )
+    noisy_error = rmse(read_pfm(path("beauty")), reference)
+    denoised_error = rmse(read_pfm(path("denoised")), reference)
+
+    print(scene)
+    print(
+        "    {0:4d} paths, noisy:     rmse {1:.4f}".format(
+            args.paths,
+            noisy_error,
+        )
+    )
+    print(
+        "    {0:4d} paths, denoised:  rmse {1:.4f}, "
+        "{2:.3f}s render and features, {3:.3f}s filter".format(
+            args.paths,
+            denoised_error,
+            seconds,
+            filter_seconds,
+        )
+    )
+
+    paths = args.paths
+    while paths < args.max_paths:
+        paths *= 2
+        seconds = render(
+            args.renderer,
+            scene,
+            path("brute_force"),
+            BEAUTY_AOV,
+            paths,
+            0,
+            renderer_args,
+        )
+        error = rmse(read_pfm(path("brute_force")), reference)
+        print(
+            "    {0:4d} paths, unfiltered: rmse {1:.4f}, {2:.3f}s render".format(
+                paths,
+                error,
+                seconds,
+            )
+        )
+        if error <= denoised_error:
+            break
+    else:
+        print(
+            "    {0} paths do not reach the error of the denoised render".format(
+                args.max_paths,
+            )
+        )
+
+
+def main():
+    """Compare the denoised and brute force renders of every scene."""
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("renderer", help="the path to ray_march_cpu")
+    parser.add_argument("denoiser", help="the path to denoise_cpu")
+    parser.add_argument("scenes", nargs="+", help="the scenes to render")
+    parser.add_argument(
+        "--paths",
+        type=int,
+        default=4,
+        help="the paths per pixel of the render that is denoised",
+    )
+    parser.add_argument(
+        "--iterations",
+        type=int,
+        default=5,
+        help="the number of chained denoise iterations",
+    )
+    parser.add_argument(
+        "--max-paths",
+        type=int,
+        default=256,
+        help="the most paths per pixel to try without filtering",
+    )
+    parser.add_argument(
+        "--reference-paths",
+        type=int,
+        default=1024,
+        help="the paths per pixel of the reference",
+    )
+    # Any other arguments, like --set, are passed on to the renderer
+    args, renderer_args = parser.parse_known_args()
+
+    for scene in args.scenes:
+        compare(args, scene, renderer_args)
+
+
+if __name__ == "__main__":
+    main()
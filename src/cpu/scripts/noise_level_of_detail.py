@@ -0,0 +1,132 @@
+# Copyright 2022 by Owen Bulka.
+# All rights reserved.
+# This file is released under the "MIT License Agreement".
+# Please see the LICENSE.md file that should have been included as part
+# of this package.
+"""Time a scene with the noise level of detail on and off.
+
+Renders the scene with the CPU renderer, scalar and single threaded,
+with the 'Noise Level of Detail' param on and then off, a few times
+each, and prints the fastest time of each along with the difference
+between the two images.
+
+    python3 src/cpu/scripts/noise_level_of_detail.py \\
+        build/ray_march_cpu examples/noisy_glass.scene --runs 3 \\
+        --set "Screen Width=240" --set "Screen Height=160"
+"""
+import argparse
+import math
+import os
+import re
+import struct
+import subprocess
+import tempfile
+
+
+def read_pfm(path):
+    """Read the values of a PFM image.
+
+    Args:
+        path (str): The path to the image.
+
+    Returns:
+        list(float): The values of every channel of every pixel.
+    """
+    with open(path, "rb") as pfm_file:
+        pfm_file.readline()
+        pfm_file.readline()
+        scale = float(pfm_file.readline())
+        data = pfm_file.read()
+    byte_order = "<" if scale < 0 else ">"
+    return struct.unpack(
+        "{0}{1}f".format(byte_order, len(data) // 4),
+        data,
+    )
+
+
+def render(renderer, scene, output, level_of_detail, extra_args):
+    """Render the scene and return the time the renderer reports.
+
+    Args:
+        renderer (str): The path to ray_march_cpu.
+        scene (str): The path to the scene file.
+        output (str): The PFM to write.
+        level_of_detail (bool): Whether to cull the fine noise octaves.
+        extra_args (list(str)): Any more arguments for the renderer.
+
+    Returns:
+        float: The render time in seconds.
+    """
+    result = subprocess.run(
+        [
+            renderer,
+            scene,
+            output,
+            "--quiet",
+            "--scalar",
+            "--threads",
+            "1",
+            "--set",
+            "Noise Level of Detail={0}".format(
+                "true" if level_of_detail else "false"
+            ),
+        ]
+        + extra_args,
+        check=True,
+        stdout=subprocess.PIPE,
+        universal_newlines=True,
+    )
+    match = re.search(r"threads: ([\d.]+)s", result.stdout)
+    return float(match.group(1))
+
+
+def main():
+    """Time the renders and compare the images."""
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("renderer", help="the path to ray_march_cpu")
+    parser.add_argument("scene", help="the scene to render")
+    parser.add_argument(
+        "--runs",
+        type=int,
+        default=3,
+        help="the number of renders of each, the fastest is kept",
+    )
+    # Any other arguments, like --set, are passed on to the renderer
+    args, renderer_args = parser.parse_known_args()
+
+    directory = tempfile.mkdtemp()
+    times = {}
+    images = {}
+    for level_of_detail in (False, True):
+        output = os.path.join(
+            directory,
+            "lod.pfm" if level_of_detail else "full.pfm",
+        )
+        times[level_of_detail] = min(
+            render(
+                args.renderer,
+                args.scene,
+                output,
+                level_of_detail,
+                renderer_args,
+            )
+            for _ in range(args.runs)
+        )
+        images[level_of_detail] = read_pfm(output)
+
+    differences = [
+        abs(full - culled)
+        for full, culled in zip(images[False], images[True])
+    ]
+    print("every octave:         {0:.3f}s".format(times[False]))
+    print("noise level of detail: {0:.3f}s".format(times[True]))
+    print(
+        "difference: rmse {0:.3g}, largest {1:.3g}".format(
+            math.sqrt(sum(d * d for d in differences) / len(differences)),
+            max(differences),
+        )
+    )
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,170 @@
+# Copyright 2022 by Owen Bulka.
+# All rights reserved.
+# This file is released under the "MIT License Agreement".
+# Please see the LICENSE.md file that should have been included as part
+# of this package.
+"""Simulate how the tile schedules of the CPU renderer scale.
+
+Reads the per tile times printed by a single threaded render, and
+simulates rendering the same tiles on more threads with:
+ - a static schedule of 64 pixel tiles, every thread taking every
+   numThreads'th tile of the spiral, as the renderer used to
+ - the same static schedule of the given tiles
+ - the work stealing schedule of src/cpu/tile_scheduler.cpp
+
+It prints the speedup of each over one thread. Use this where there are
+not enough cores to measure the scaling directly.
+
+    build/ray_march_cpu examples/glass_spheres.scene out.pfm \\
+        --threads 1 --tile-size 16 > tiles.txt
+    python3 src/cpu/scripts/tile_scaling.py tiles.txt
+"""
+import argparse
+import heapq
+import random
+import re
+
+
+TILE_PATTERN = re.compile(
+    r"tile (\d+) at \((\d+), (\d+)\) (\d+)x(\d+) on thread \d+[^:]*: ([\d.]+)s"
+)
+
+
+def read_tiles(path):
+    """Read the tiles from the output of a render.
+
+    Args:
+        path (str): The path to the output of ray_march_cpu.
+
+    Returns:
+        list(tuple(int, int, int, int, int, float)): The index, x and y
+            position, width and height, and the render time of every
+            tile, in the render order.
+    """
+    tiles = []
+    with open(path) as log_file:
+        for line in log_file:
+            match = TILE_PATTERN.match(line)
+            if match:
+                tiles.append((
+                    int(match.group(1)),
+                    int(match.group(2)),
+                    int(match.group(3)),
+                    int(match.group(4)),
+                    int(match.group(5)),
+                    float(match.group(6)),
+                ))
+    return sorted(tiles)
+
+
+def merge_tiles(tiles, tile_size):
+    """Merge the tiles into larger ones, in spiral order from the centre.
+
+    Args:
+        tiles (list(tuple(int, int, int, int, int, float))): The tiles.
+        tile_size (int): The size of the larger tiles.
+
+    Returns:
+        list(float): The render time of each larger tile, in order.
+    """
+    costs = {}
+    for _, x, y, _, _, cost in tiles:
+        key = (x // tile_size, y // tile_size)
+        costs[key] = costs.get(key, 0.0) + cost
+
+    centre_x = max(tile[1] + tile[3] for tile in tiles) / 2.0
+    centre_y = max(tile[2] + tile[4] for tile in tiles) / 2.0
+
+    def distance_from_centre(key):
+        return (
+            ((key[0] + 0.5) * tile_size - centre_x) ** 2
+            + ((key[1] + 0.5) * tile_size - centre_y) ** 2
+        )
+
+    return [costs[key] for key in sorted(costs, key=distance_from_centre)]
+
+
+def static_schedule(costs, num_threads):
+    """Get the frame time when every thread takes a fixed share.
+
+    Args:
+        costs (list(float)): The render time of each tile, in order.
+        num_threads (int): The number of threads.
+
+    Returns:
+        float: The time of the slowest thread.
+    """
+    return max(
+        sum(costs[thread::num_threads])
+        for thread in range(num_threads)
+    )
+
+
+def stealing_schedule(costs, num_threads, seed=1):
+    """Get the frame time when idle threads steal half of a queue.
+
+    Args:
+        costs (list(float)): The render time of each tile, in order.
+        num_threads (int): The number of threads.
+        seed (int): The seed for choosing the victims.
+
+    Returns:
+        float: The time the last thread finishes.
+    """
+    rng = random.Random(seed)
+    queues = [
+        list(range(thread, len(costs), num_threads))
+        for thread in range(num_threads)
+    ]
+    events = [(0.0, thread) for thread in range(num_threads)]
+    end = 0.0
+    while events:
+        now, thread = heapq.heappop(events)
+        if not queues[thread]:
+            victims = [
+                victim for victim in range(num_threads) if queues[victim]
+            ]
+            if not victims:
+                end = max(end, now)
+                continue
+            victim = rng.choice(victims)
+            num_stolen = (len(queues[victim]) + 1) // 2
+            queues[thread] = queues[victim][-num_stolen:]
+            del queues[victim][-num_stolen:]
+        tile = queues[thread].pop(0)
+        heapq.heappush(events, (now + costs[tile], thread))
+    return end
+
+
+def main():
+    """Print the simulated speedups."""
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("log", help="the output of a single threaded render")
+    parser.add_argument(
+        "--threads",
+        type=int,
+        nargs="+",
+        default=[1, 2, 4, 8, 16, 32, 64],
+        help="the thread counts to simulate",
+    )
+    args = parser.parse_args()
+
+    tiles = read_tiles(args.log)
+    costs = [tile[5] for tile in tiles]
+    large_costs = merge_tiles(tiles, 64)
+    total = sum(costs)
+
+    print("threads  static, 64px  static, tiles  stealing, tiles")
+    for num_threads in args.threads:
+        print(
+            "{0:7d}  {1:11.1f}x  {2:12.1f}x  {3:14.1f}x".format(
+                num_threads,
+                total / static_schedule(large_costs, num_threads),
+                total / static_schedule(costs, num_threads),
+                total / stealing_schedule(costs, num_threads),
+            )
+        )
+
+
+if __name__ == "__main__":
+    main()
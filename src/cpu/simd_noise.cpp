@@ -0,0 +1,439 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+#include "blink.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+
+//
+// The lanes of a SIMD register, and the few operations the noise needs.
+// The comparisons give 1 or 0 in each lane, as the scalar noise does.
+// The float lanes add, subtract, and multiply with the vector operators
+// of GCC and Clang.
+//
+
+#if defined(__AVX2__)
+
+#define NOISE_LANES 8
+#define NOISE_INSTRUCTIONS "AVX2"
+
+typedef __m256 FloatLanes;
+typedef __m256i IntLanes;
+
+static inline FloatLanes loadFloats(const float *values) { return _mm256_loadu_ps(values); }
+static inline void storeFloats(float *values, const FloatLanes &a) { _mm256_storeu_ps(values, a); }
+static inline FloatLanes splat(const float value) { return _mm256_set1_ps(value); }
+static inline IntLanes splat(const int value) { return _mm256_set1_epi32(value); }
+static inline FloatLanes maxLanes(const FloatLanes &a, const FloatLanes &b) { return _mm256_max_ps(a, b); }
+static inline IntLanes greaterThan(const FloatLanes &a, const FloatLanes &b)
+{
+    return _mm256_and_si256(
+        _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_GT_OQ)),
+        _mm256_set1_epi32(1)
+    );
+}
+static inline IntLanes floorToInt(const FloatLanes &a) { return _mm256_cvttps_epi32(_mm256_floor_ps(a)); }
+static inline FloatLanes toFloat(const IntLanes &a) { return _mm256_cvtepi32_ps(a); }
+static inline IntLanes addInts(const IntLanes &a, const IntLanes &b) { return _mm256_add_epi32(a, b); }
+static inline IntLanes subtractInts(const IntLanes &a, const IntLanes &b) { return _mm256_sub_epi32(a, b); }
+static inline IntLanes multiplyInts(const IntLanes &a, const IntLanes &b) { return _mm256_mullo_epi32(a, b); }
+static inline IntLanes xorInts(const IntLanes &a, const IntLanes &b) { return _mm256_xor_si256(a, b); }
+static inline IntLanes andInts(const IntLanes &a, const IntLanes &b) { return _mm256_and_si256(a, b); }
+static inline IntLanes shiftRight(const IntLanes &a, const int bits) { return _mm256_srai_epi32(a, bits); }
+static inline IntLanes shiftLeft(const IntLanes &a, const int bits) { return _mm256_slli_epi32(a, bits); }
+static inline IntLanes greaterThan(const IntLanes &a, const IntLanes &b)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi32(a, b), _mm256_set1_epi32(1));
+}
+static inline IntLanes equal(const IntLanes &a, const IntLanes &b)
+{
+    return _mm256_and_si256(_mm256_cmpeq_epi32(a, b), _mm256_set1_epi32(1));
+}
+
+#elif defined(__SSE2__)
+
+#define NOISE_LANES 4
+#define NOISE_INSTRUCTIONS "SSE2"
+
+typedef __m128 FloatLanes;
+typedef __m128i IntLanes;
+
+static inline FloatLanes loadFloats(const float *values) { return _mm_loadu_ps(values); }
+static inline void storeFloats(float *values, const FloatLanes &a) { _mm_storeu_ps(values, a); }
+static inline FloatLanes splat(const float value) { return _mm_set1_ps(value); }
+static inline IntLanes splat(const int value) { return _mm_set1_epi32(value); }
+static inline FloatLanes maxLanes(const FloatLanes &a, const FloatLanes &b) { return _mm_max_ps(a, b); }
+static inline IntLanes greaterThan(const FloatLanes &a, const FloatLanes &b)
+{
+    return _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(a, b)), _mm_set1_epi32(1));
+}
+static inline IntLanes floorToInt(const FloatLanes &a)
+{
+    // Truncate, and step down where that rounded a negative value up
+    const IntLanes truncated = _mm_cvttps_epi32(a);
+    return _mm_add_epi32(
+        truncated,
+        _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(truncated), a))
+    );
+}
+static inline FloatLanes toFloat(const IntLanes &a) { return _mm_cvtepi32_ps(a); }
+static inline IntLanes addInts(const IntLanes &a, const IntLanes &b) { return _mm_add_epi32(a, b); }
+static inline IntLanes subtractInts(const IntLanes &a, const IntLanes &b) { return _mm_sub_epi32(a, b); }
+static inline IntLanes multiplyInts(const IntLanes &a, const IntLanes &b)
+{
+    // SSE2 only multiplies the even lanes, so multiply the odd ones
+    // separately and interleave the low halves of the products
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+    return _mm_unpacklo_epi32(
+        _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+        _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))
+    );
+}
+static inline IntLanes xorInts(const IntLanes &a, const IntLanes &b) { return _mm_xor_si128(a, b); }
+static inline IntLanes andInts(const IntLanes &a, const IntLanes &b) { return _mm_and_si128(a, b); }
+static inline IntLanes shiftRight(const IntLanes &a, const int bits) { return _mm_srai_epi32(a, bits); }
+static inline IntLanes shiftLeft(const IntLanes &a, const int bits) { return _mm_slli_epi32(a, bits); }
+static inline IntLanes greaterThan(const IntLanes &a, const IntLanes &b)
+{
+    return _mm_and_si128(_mm_cmpgt_epi32(a, b), _mm_set1_epi32(1));
+}
+static inline IntLanes equal(const IntLanes &a, const IntLanes &b)
+{
+    return _mm_and_si128(_mm_cmpeq_epi32(a, b), _mm_set1_epi32(1));
+}
+
+#elif defined(__ARM_NEON)
+
+#define NOISE_LANES 4
+#define NOISE_INSTRUCTIONS "NEON"
+
+typedef float32x4_t FloatLanes;
+typedef int32x4_t IntLanes;
+
+static inline FloatLanes loadFloats(const float *values) { return vld1q_f32(values); }
+static inline void storeFloats(float *values, const FloatLanes &a) { vst1q_f32(values, a); }
+static inline FloatLanes splat(const float value) { return vdupq_n_f32(value); }
+static inline IntLanes splat(const int value) { return vdupq_n_s32(value); }
+static inline FloatLanes maxLanes(const FloatLanes &a, const FloatLanes &b) { return vmaxq_f32(a, b); }
+static inline IntLanes greaterThan(const FloatLanes &a, const FloatLanes &b)
+{
+    return vandq_s32(vreinterpretq_s32_u32(vcgtq_f32(a, b)), vdupq_n_s32(1));
+}
+static inline IntLanes floorToInt(const FloatLanes &a)
+{
+    // Truncate, and step down where that rounded a negative value up
+    const IntLanes truncated = vcvtq_s32_f32(a);
+    return vaddq_s32(
+        truncated,
+        vreinterpretq_s32_u32(vcgtq_f32(vcvtq_f32_s32(truncated), a))
+    );
+}
+static inline FloatLanes toFloat(const IntLanes &a) { return vcvtq_f32_s32(a); }
+static inline IntLanes addInts(const IntLanes &a, const IntLanes &b) { return vaddq_s32(a, b); }
+static inline IntLanes subtractInts(const IntLanes &a, const IntLanes &b) { return vsubq_s32(a, b); }
+static inline IntLanes multiplyInts(const IntLanes &a, const IntLanes &b) { return vmulq_s32(a, b); }
+static inline IntLanes xorInts(const IntLanes &a, const IntLanes &b) { return veorq_s32(a, b); }
+static inline IntLanes andInts(const IntLanes &a, const IntLanes &b) { return vandq_s32(a, b); }
+static inline IntLanes shiftRight(const IntLanes &a, const int bits) { return vshlq_s32(a, vdupq_n_s32(-bits)); }
+static inline IntLanes shiftLeft(const IntLanes &a, const int bits) { return vshlq_s32(a, vdupq_n_s32(bits)); }
+static inline IntLanes greaterThan(const IntLanes &a, const IntLanes &b)
+{
+    return vandq_s32(vreinterpretq_s32_u32(vcgtq_s32(a, b)), vdupq_n_s32(1));
+}
+static inline IntLanes equal(const IntLanes &a, const IntLanes &b)
+{
+    return vandq_s32(vreinterpretq_s32_u32(vceqq_s32(a, b)), vdupq_n_s32(1));
+}
+
+#else
+
+#define NOISE_LANES 1
+#define NOISE_INSTRUCTIONS "scalar"
+
+typedef float FloatLanes;
+typedef int IntLanes;
+
+static inline FloatLanes loadFloats(const float *values) { return *values; }
+static inline void storeFloats(float *values, const FloatLanes &a) { *values = a; }
+static inline FloatLanes splat(const float value) { return value; }
+static inline IntLanes splat(const int value) { return value; }
+static inline FloatLanes maxLanes(const FloatLanes &a, const FloatLanes &b) { return max(a, b); }
+static inline IntLanes greaterThan(const FloatLanes &a, const FloatLanes &b) { return a > b ? 1 : 0; }
+static inline IntLanes floorToInt(const FloatLanes &a) { return (int) std::floor(a); }
+static inline FloatLanes toFloat(const IntLanes &a) { return (float) a; }
+static inline IntLanes addInts(const IntLanes &a, const IntLanes &b) { return a + b; }
+static inline IntLanes subtractInts(const IntLanes &a, const IntLanes &b) { return a - b; }
+static inline IntLanes multiplyInts(const IntLanes &a, const IntLanes &b)
+{
+    // Wrap on overflow, as the scalar hash does
+    return (int) ((uint32_t) a * (uint32_t) b);
+}
+static inline IntLanes xorInts(const IntLanes &a, const IntLanes &b) { return a ^ b; }
+static inline IntLanes andInts(const IntLanes &a, const IntLanes &b) { return a & b; }
+static inline IntLanes shiftRight(const IntLanes &a, const int bits) { return a >> bits; }
+static inline IntLanes shiftLeft(const IntLanes &a, const int bits) { return (int) ((uint32_t) a << bits); }
+static inline IntLanes greaterThan(const IntLanes &a, const IntLanes &b) { return a > b ? 1 : 0; }
+static inline IntLanes equal(const IntLanes &a, const IntLanes &b) { return a == b ? 1 : 0; }
+
+#endif
+
+
+// The lanes of a 4D vector
+struct Float4Lanes
+{
+    FloatLanes x;
+    FloatLanes y;
+    FloatLanes z;
+    FloatLanes w;
+};
+
+
+/**
+ * Get the dot product of two vectors of lanes, summed in the order of
+ * the scalar 'dot'.
+ */
+static inline FloatLanes dotLanes(const Float4Lanes &a, const Float4Lanes &b)
+{
+    return splat(0.0f) + a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+
+/**
+ * Step a vector of lanes back from a corner of the simplex, as the
+ * offsets of the scalar noise are.
+ *
+ * @arg offset: The offset from the first corner.
+ * @arg i: The x step to the corner, 0 or 1.
+ * @arg j: The y step to the corner, 0 or 1.
+ * @arg k: The z step to the corner, 0 or 1.
+ * @arg l: The w step to the corner, 0 or 1.
+ * @arg unskew: The unskewing of the corner.
+ *
+ * @returns: The offset from the corner.
+ */
+static inline Float4Lanes cornerOffset(
+        const Float4Lanes &offset,
+        const IntLanes &i,
+        const IntLanes &j,
+        const IntLanes &k,
+        const IntLanes &l,
+        const float unskew)
+{
+    return Float4Lanes{
+        offset.x - toFloat(i) + splat(unskew),
+        offset.y - toFloat(j) + splat(unskew),
+        offset.z - toFloat(k) + splat(unskew),
+        offset.w - toFloat(l) + splat(unskew),
+    };
+}
+
+
+/**
+ * The lanes of 'wangHash', with arithmetic shifts like the int version.
+ */
+static inline IntLanes wangHashLanes(IntLanes seed)
+{
+    seed = xorInts(xorInts(seed, splat(61)), shiftRight(seed, 16));
+    seed = multiplyInts(seed, splat(9));
+    seed = xorInts(seed, shiftRight(seed, 4));
+    seed = multiplyInts(seed, splat(0x27d4eb2d));
+    return xorInts(seed, shiftRight(seed, 15));
+}
+
+
+/**
+ * The lanes of 'latticeHash'.
+ */
+static inline IntLanes latticeHashLanes(
+        const IntLanes &i,
+        const IntLanes &j,
+        const IntLanes &k,
+        const IntLanes &l)
+{
+    return wangHashLanes(xorInts(
+        xorInts(multiplyInts(i, splat(73856093)), multiplyInts(j, splat(19349663))),
+        xorInts(multiplyInts(k, splat(83492791)), multiplyInts(l, splat(50331653)))
+    ));
+}
+
+
+/**
+ * The lanes of 'simplexCornerContribution', with the gradient of
+ * 'hashedGradient'.
+ *
+ * @arg offset: The offset of the seed from the corner.
+ * @arg hash: The hash of the corner.
+ *
+ * @returns: The contribution of the corner.
+ */
+static inline FloatLanes cornerContributionLanes(const Float4Lanes &offset, const IntLanes &hash)
+{
+    const IntLanes one = splat(1);
+    const IntLanes two = splat(2);
+    const IntLanes h = andInts(hash, splat(31));
+
+    const FloatLanes a = toFloat(subtractInts(one, andInts(shiftRight(h, 1), two)));
+    const FloatLanes b = toFloat(subtractInts(one, andInts(h, two)));
+    const FloatLanes c = toFloat(subtractInts(one, andInts(shiftLeft(h, 1), two)));
+
+    // The zero component is 0 to 3, so its upper bit is whether it is
+    // at least 2
+    const IntLanes zeroComponent = shiftRight(h, 3);
+    const IntLanes upperHalf = shiftRight(zeroComponent, 1);
+    const IntLanes first = equal(zeroComponent, splat(0));
+    const IntLanes last = equal(zeroComponent, splat(3));
+    const Float4Lanes gradient = {
+        toFloat(subtractInts(one, first)) * a,
+        toFloat(first) * a + toFloat(upperHalf) * b,
+        toFloat(subtractInts(one, upperHalf)) * b + toFloat(last) * c,
+        toFloat(subtractInts(one, last)) * c,
+    };
+
+    FloatLanes t = maxLanes(splat(0.6f) - dotLanes(offset, offset), splat(0.0f));
+    t = t * t;
+    return t * t * dotLanes(gradient, offset);
+}
+
+
+/**
+ * The lanes of the table free 'perlinSimplexNoise'.
+ *
+ * @arg seed: The seeds for the noise.
+ *
+ * @returns: The noise values.
+ */
+static FloatLanes simplexNoiseLanes(const Float4Lanes &seed)
+{
+    const float F4 = (sqrt(5.0f) - 1.0f) / 4.0f;
+    const float G4 = (5.0f - sqrt(5.0f)) / 20.0f;
+
+    // Skew the input space to determine which simplex cell we're in
+    const FloatLanes s = (seed.x + seed.y + seed.z + seed.w) * splat(F4);
+    const IntLanes i = floorToInt(seed.x + s);
+    const IntLanes j = floorToInt(seed.y + s);
+    const IntLanes k = floorToInt(seed.z + s);
+    const IntLanes l = floorToInt(seed.w + s);
+
+    // Unskew the cell origin back to (x,y,z,w) space
+    const FloatLanes t = toFloat(addInts(addInts(addInts(i, j), k), l)) * splat(G4);
+    const Float4Lanes offset0 = {
+        seed.x - (toFloat(i) - t),
+        seed.y - (toFloat(j) - t),
+        seed.z - (toFloat(k) - t),
+        seed.w - (toFloat(l) - t),
+    };
+
+    // Rank the components of the offset
+    const IntLanes xy = greaterThan(offset0.x, offset0.y);
+    const IntLanes xz = greaterThan(offset0.x, offset0.z);
+    const IntLanes xw = greaterThan(offset0.x, offset0.w);
+    const IntLanes yz = greaterThan(offset0.y, offset0.z);
+    const IntLanes yw = greaterThan(offset0.y, offset0.w);
+    const IntLanes zw = greaterThan(offset0.z, offset0.w);
+    const IntLanes rankX = addInts(addInts(xy, xz), xw);
+    const IntLanes rankY = addInts(addInts(subtractInts(splat(1), xy), yz), yw);
+    const IntLanes rankZ = addInts(subtractInts(subtractInts(splat(2), xz), yz), zw);
+    const IntLanes rankW = subtractInts(subtractInts(subtractInts(splat(3), xw), yw), zw);
+
+    const IntLanes i1 = greaterThan(rankX, splat(2));
+    const IntLanes j1 = greaterThan(rankY, splat(2));
+    const IntLanes k1 = greaterThan(rankZ, splat(2));
+    const IntLanes l1 = greaterThan(rankW, splat(2));
+    const IntLanes i2 = greaterThan(rankX, splat(1));
+    const IntLanes j2 = greaterThan(rankY, splat(1));
+    const IntLanes k2 = greaterThan(rankZ, splat(1));
+    const IntLanes l2 = greaterThan(rankW, splat(1));
+    const IntLanes i3 = greaterThan(rankX, splat(0));
+    const IntLanes j3 = greaterThan(rankY, splat(0));
+    const IntLanes k3 = greaterThan(rankZ, splat(0));
+    const IntLanes l3 = greaterThan(rankW, splat(0));
+    const IntLanes one = splat(1);
+
+    const Float4Lanes offset1 = cornerOffset(offset0, i1, j1, k1, l1, G4);
+    const Float4Lanes offset2 = cornerOffset(offset0, i2, j2, k2, l2, 2.0f * G4);
+    const Float4Lanes offset3 = cornerOffset(offset0, i3, j3, k3, l3, 3.0f * G4);
+    const Float4Lanes offset4 = cornerOffset(offset0, one, one, one, one, 4.0f * G4);
+
+    const IntLanes gi0 = latticeHashLanes(i, j, k, l);
+    const IntLanes gi1 = latticeHashLanes(addInts(i, i1), addInts(j, j1), addInts(k, k1), addInts(l, l1));
+    const IntLanes gi2 = latticeHashLanes(addInts(i, i2), addInts(j, j2), addInts(k, k2), addInts(l, l2));
+    const IntLanes gi3 = latticeHashLanes(addInts(i, i3), addInts(j, j3), addInts(k, k3), addInts(l, l3));
+    const IntLanes gi4 = latticeHashLanes(addInts(i, one), addInts(j, one), addInts(k, one), addInts(l, one));
+
+    return splat(27.0f) * (
+        cornerContributionLanes(offset0, gi0)
+        + cornerContributionLanes(offset1, gi1)
+        + cornerContributionLanes(offset2, gi2)
+        + cornerContributionLanes(offset3, gi3)
+        + cornerContributionLanes(offset4, gi4)
+    );
+}
+
+
+const char *simdNoiseInstructions()
+{
+    return NOISE_INSTRUCTIONS;
+}
+
+
+bool &simdNoiseEnabled()
+{
+    static bool enabled = true;
+    return enabled;
+}
+
+
+void simdPerlinSimplexNoise(
+        const float *x,
+        const float *y,
+        const float *z,
+        const float *w,
+        const int count,
+        float *noise)
+{
+    int first = 0;
+    for (; first + NOISE_LANES <= count; first += NOISE_LANES)
+    {
+        storeFloats(noise + first, simplexNoiseLanes(Float4Lanes{
+            loadFloats(x + first),
+            loadFloats(y + first),
+            loadFloats(z + first),
+            loadFloats(w + first),
+        }));
+    }
+    if (first == count)
+    {
+        return;
+    }
+
+    // The lanes past the last seed repeat it, and are discarded
+    float seeds[4][NOISE_LANES];
+    float values[NOISE_LANES];
+    for (int lane=0; lane < NOISE_LANES; lane++)
+    {
+        const int seed = min(first + lane, count - 1);
+        seeds[0][lane] = x[seed];
+        seeds[1][lane] = y[seed];
+        seeds[2][lane] = z[seed];
+        seeds[3][lane] = w[seed];
+    }
+    storeFloats(values, simplexNoiseLanes(Float4Lanes{
+        loadFloats(seeds[0]),
+        loadFloats(seeds[1]),
+        loadFloats(seeds[2]),
+        loadFloats(seeds[3]),
+    }));
+    for (int seed=first; seed < count; seed++)
+    {
+        noise[seed] = values[seed - first];
+    }
+}
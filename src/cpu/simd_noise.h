@@ -0,0 +1,128 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+//
+// The table free simplex noise, evaluated for several seeds at once with
+// SIMD instructions
+//
+// On the CPU the table free fBm in 'noise.h' gathers the seeds of its
+// octaves into a 'SimdNoiseSum', which evaluates them a register at a
+// time, with AVX2 when the compiler targets it, SSE2 on other x86-64
+// CPUs, NEON on ARM, and one seed at a time elsewhere. The operations
+// are those of the scalar noise, in the same order, so the results
+// match it.
+//
+// Included by 'blink.h' once the vector types are defined.
+//
+
+#pragma once
+
+
+// The most seeds gathered before they are evaluated, a whole number of
+// registers for every instruction set
+#define SIMD_NOISE_BATCH 8
+
+
+/**
+ * Get the name of the instruction set the noise is evaluated with.
+ *
+ * @returns: 'AVX2', 'SSE2', 'NEON', or 'scalar'.
+ */
+const char *simdNoiseInstructions();
+
+
+/**
+ * Get whether the table free fBm evaluates its octaves with SIMD, rather
+ * than one at a time with the scalar noise. On by default, the switch is
+ * only for comparing the two.
+ *
+ * @returns: A reference to the switch.
+ */
+bool &simdNoiseEnabled();
+
+
+/**
+ * Evaluate the table free 4D simplex noise at several seeds.
+ *
+ * @arg x: The x components of the seeds.
+ * @arg y: The y components of the seeds.
+ * @arg z: The z components of the seeds.
+ * @arg w: The w components of the seeds.
+ * @arg count: The number of seeds.
+ * @arg noise: The location to store the noise of each seed, in the
+ *     range [-1, 1].
+ */
+void simdPerlinSimplexNoise(
+        const float *x,
+        const float *y,
+        const float *z,
+        const float *w,
+        const int count,
+        float *noise);
+
+
+/**
+ * A weighted sum of the table free noise at several seeds, which are
+ * evaluated together once a batch of them is gathered.
+ */
+struct SimdNoiseSum
+{
+    float x[SIMD_NOISE_BATCH];
+    float y[SIMD_NOISE_BATCH];
+    float z[SIMD_NOISE_BATCH];
+    float w[SIMD_NOISE_BATCH];
+    float weights[SIMD_NOISE_BATCH];
+    int count = 0;
+    float total = 0.0f;
+
+    /**
+     * Add the noise at a seed to the sum.
+     *
+     * @arg seed: The seed of the noise.
+     * @arg weight: The amount to multiply the noise by.
+     */
+    inline void add(const float4 &seed, const float weight)
+    {
+        x[count] = seed.x;
+        y[count] = seed.y;
+        z[count] = seed.z;
+        w[count] = seed.w;
+        weights[count] = weight;
+        if (++count == SIMD_NOISE_BATCH)
+        {
+            flush();
+        }
+    }
+
+    /**
+     * Evaluate the gathered seeds, and add them to the total in the
+     * order they were added.
+     */
+    inline void flush()
+    {
+        float noise[SIMD_NOISE_BATCH];
+        simdPerlinSimplexNoise(x, y, z, w, count, noise);
+        for (int seed=0; seed < count; seed++)
+        {
+            total += weights[seed] * noise[seed];
+        }
+        count = 0;
+    }
+
+    /**
+     * Get the sum of every seed added.
+     *
+     * @returns: The weighted sum of the noise.
+     */
+    inline float sum()
+    {
+        if (count > 0)
+        {
+            flush();
+        }
+        return total;
+    }
+};
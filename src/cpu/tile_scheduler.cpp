@@ -0,0 +1,76 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+#include "tile_scheduler.h"
+
+
+TileScheduler::TileScheduler(const int numTiles, const int numThreads)
+{
+    for (int threadIndex=0; threadIndex < numThreads; threadIndex++)
+    {
+        _queues.push_back(std::unique_ptr<ThreadQueue>(new ThreadQueue()));
+        _queues.back()->randomState = 2654435761u * (threadIndex + 1);
+    }
+    for (int tileIndex=0; tileIndex < numTiles; tileIndex++)
+    {
+        _queues[tileIndex % numThreads]->tiles.push_back(tileIndex);
+    }
+}
+
+
+bool TileScheduler::nextTile(const int threadIndex, int &tileIndex, bool &stolen)
+{
+    ThreadQueue &own = *_queues[threadIndex];
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tiles.empty())
+        {
+            tileIndex = own.tiles.front();
+            own.tiles.pop_front();
+            stolen = false;
+            return true;
+        }
+    }
+
+    // Start from a random thread, so the thieves spread out over the
+    // victims, and try every other thread before giving up. Tiles are
+    // never given back, so once every queue is empty the frame is done
+    own.randomState ^= own.randomState << 13;
+    own.randomState ^= own.randomState >> 17;
+    own.randomState ^= own.randomState << 5;
+    const int numThreads = (int) _queues.size();
+    const int first = (int) (own.randomState % numThreads);
+    for (int offset=0; offset < numThreads; offset++)
+    {
+        const int victimIndex = (first + offset) % numThreads;
+        if (victimIndex == threadIndex)
+        {
+            continue;
+        }
+
+        // Hold both queues while the tiles move, so that they are never
+        // in neither queue for another thief to miss
+        ThreadQueue &victim = *_queues[victimIndex];
+        std::lock(own.mutex, victim.mutex);
+        std::lock_guard<std::mutex> ownLock(own.mutex, std::adopt_lock);
+        std::lock_guard<std::mutex> victimLock(victim.mutex, std::adopt_lock);
+        if (victim.tiles.empty())
+        {
+            continue;
+        }
+
+        // Take the back half, the tiles the victim would reach last
+        const size_t numStolen = (victim.tiles.size() + 1) / 2;
+        own.tiles.assign(victim.tiles.end() - numStolen, victim.tiles.end());
+        victim.tiles.erase(victim.tiles.end() - numStolen, victim.tiles.end());
+
+        tileIndex = own.tiles.front();
+        own.tiles.pop_front();
+        stolen = true;
+        return true;
+    }
+    return false;
+}
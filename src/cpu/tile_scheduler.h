@@ -0,0 +1,64 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+//
+// Handing out the tiles of a frame to the render threads
+//
+// The cost of a pixel varies enormously, sky pixels stop after a few
+// steps while caustics trace hundreds of paths, so a fixed share of the
+// tiles per thread leaves most threads idle at the end of a frame. Here
+// every thread starts with its own queue of tiles, dealt out in the
+// render order, and works through it from the front. Once its queue is
+// empty it steals half of the queue of another thread, chosen at
+// random, from the back (Blumofe and Leiserson 1999), so that the
+// threads only ever contend over the last tiles of a frame.
+//
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+class TileScheduler
+{
+public:
+    /**
+     * Deal out the tiles to the threads, every thread gets every
+     * numThreads'th tile, so each queue keeps the render order.
+     *
+     * @arg numTiles: The number of tiles, in the render order.
+     * @arg numThreads: The number of threads that will take tiles.
+     */
+    TileScheduler(const int numTiles, const int numThreads);
+
+    /**
+     * Take the next tile for a thread to render, from its own queue, or
+     * stolen from another thread once its own is empty.
+     *
+     * @arg threadIndex: The index of the calling thread.
+     * @arg tileIndex: The location to store the index of the tile.
+     * @arg stolen: The location to store whether the tile was stolen.
+     *
+     * @returns: Whether there was a tile left, otherwise the frame is
+     *     done.
+     */
+    bool nextTile(const int threadIndex, int &tileIndex, bool &stolen);
+
+private:
+    // The queue of a thread, and the state of the random number
+    // generator it chooses the threads to steal from with
+    struct ThreadQueue
+    {
+        std::mutex mutex;
+        std::deque<int> tiles;
+        unsigned int randomState;
+    };
+
+    std::vector<std::unique_ptr<ThreadQueue>> _queues;
+};
@@ -0,0 +1,183 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+#include "tiles.h"
+
+#include <algorithm>
+
+
+bool parseTileOrder(const std::string &name, TileOrder &order)
+{
+    if (name == "scanline")
+    {
+        order = eScanlineOrder;
+        return true;
+    }
+    if (name == "spiral")
+    {
+        order = eSpiralOrder;
+        return true;
+    }
+    if (name == "hilbert")
+    {
+        order = eHilbertOrder;
+        return true;
+    }
+    return false;
+}
+
+
+/**
+ * Get the position of a point along a Hilbert curve (Hilbert 1891).
+ *
+ * @arg size: The width of the square the curve fills, a power of two.
+ * @arg distance: The distance of the point along the curve.
+ * @arg x: The location to store the x position of the point.
+ * @arg y: The location to store the y position of the point.
+ */
+static void hilbertPoint(const int size, int distance, int &x, int &y)
+{
+    x = 0;
+    y = 0;
+    for (int scale=1; scale < size; scale *= 2)
+    {
+        const int right = 1 & (distance / 2);
+        const int up = 1 & (distance ^ right);
+
+        // Rotate the quadrant so the curve joins onto the next one
+        if (up == 0)
+        {
+            if (right == 1)
+            {
+                x = scale - 1 - x;
+                y = scale - 1 - y;
+            }
+            std::swap(x, y);
+        }
+
+        x += scale * right;
+        y += scale * up;
+        distance /= 4;
+    }
+}
+
+
+void mortonPoint(unsigned int index, int &x, int &y)
+{
+    // The even bits of the index are the bits of x, the odd ones of y
+    x = 0;
+    y = 0;
+    for (int bit=0; index > 0; bit++, index >>= 2)
+    {
+        x |= (index & 1) << bit;
+        y |= ((index >> 1) & 1) << bit;
+    }
+}
+
+
+/**
+ * Walk a square spiral outwards from a tile, until every tile of the
+ * grid has been visited.
+ *
+ * @arg columns: The number of columns of tiles.
+ * @arg rows: The number of rows of tiles.
+ * @arg cells: The location to store the column and row of each tile,
+ *     in the order they were visited.
+ */
+static void spiralCells(
+        const int columns,
+        const int rows,
+        std::vector<std::pair<int, int>> &cells)
+{
+    const int numTiles = columns * rows;
+    int column = (columns - 1) / 2;
+    int row = (rows - 1) / 2;
+
+    const int stepColumn[4] = {1, 0, -1, 0};
+    const int stepRow[4] = {0, 1, 0, -1};
+
+    cells.push_back(std::make_pair(column, row));
+    for (int legLength=1, direction=0; (int) cells.size() < numTiles; direction++)
+    {
+        for (int step=0; step < legLength; step++)
+        {
+            column += stepColumn[direction % 4];
+            row += stepRow[direction % 4];
+            if (column >= 0 && column < columns && row >= 0 && row < rows)
+            {
+                cells.push_back(std::make_pair(column, row));
+            }
+        }
+
+        // Every second turn the legs get longer
+        if (direction % 2 == 1)
+        {
+            legLength++;
+        }
+    }
+}
+
+
+std::vector<Tile> makeTiles(
+        const int width,
+        const int height,
+        const int tileSize,
+        const TileOrder order)
+{
+    const int columns = (width + tileSize - 1) / tileSize;
+    const int rows = (height + tileSize - 1) / tileSize;
+
+    std::vector<std::pair<int, int>> cells;
+    cells.reserve(columns * rows);
+    if (order == eSpiralOrder)
+    {
+        spiralCells(columns, rows, cells);
+    }
+    else if (order == eHilbertOrder)
+    {
+        int size = 1;
+        while (size < columns || size < rows)
+        {
+            size *= 2;
+        }
+
+        // The curve covers a power of two square, skip what is outside
+        for (int distance=0; distance < size * size; distance++)
+        {
+            int column;
+            int row;
+            hilbertPoint(size, distance, column, row);
+            if (column < columns && row < rows)
+            {
+                cells.push_back(std::make_pair(column, row));
+            }
+        }
+    }
+    else
+    {
+        for (int row=0; row < rows; row++)
+        {
+            for (int column=0; column < columns; column++)
+            {
+                cells.push_back(std::make_pair(column, row));
+            }
+        }
+    }
+
+    std::vector<Tile> tiles;
+    tiles.reserve(cells.size());
+    for (const std::pair<int, int> &cell : cells)
+    {
+        Tile tile;
+        tile.index = (int) tiles.size();
+        tile.x = cell.first * tileSize;
+        tile.y = cell.second * tileSize;
+        tile.width = std::min(tileSize, width - tile.x);
+        tile.height = std::min(tileSize, height - tile.y);
+        tiles.push_back(tile);
+    }
+    return tiles;
+}
@@ -0,0 +1,73 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+//
+// Splitting a frame into tiles, and choosing the order they render in
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+enum TileOrder
+{
+    eScanlineOrder, // rows of tiles from the bottom of the frame
+    eSpiralOrder, // outwards from the centre of the frame
+    eHilbertOrder // along a Hilbert curve, so consecutive tiles touch
+};
+
+
+struct Tile
+{
+    int index; // the position of the tile in the render order
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+
+/**
+ * Parse the name of a tile order.
+ *
+ * @arg name: 'scanline', 'spiral', or 'hilbert'.
+ * @arg order: The location to store the order.
+ *
+ * @returns: Whether the name was recognised.
+ */
+bool parseTileOrder(const std::string &name, TileOrder &order);
+
+
+/**
+ * Get the position of a point along a Morton, or Z-order, curve, which
+ * visits the pixels of every aligned power of two block before leaving
+ * it.
+ *
+ * @arg index: The position of the point along the curve.
+ * @arg x: The location to store the x position of the point.
+ * @arg y: The location to store the y position of the point.
+ */
+void mortonPoint(unsigned int index, int &x, int &y);
+
+
+/**
+ * Split a frame into tiles, the tiles on the right and top edges are
+ * smaller when the frame is not a multiple of the tile size.
+ *
+ * @arg width: The width of the frame.
+ * @arg height: The height of the frame.
+ * @arg tileSize: The width and height of the tiles.
+ * @arg order: The order to render the tiles in.
+ *
+ * @returns: The tiles, in the order to render them.
+ */
+std::vector<Tile> makeTiles(
+        const int width,
+        const int height,
+        const int tileSize,
+        const TileOrder order);
@@ -0,0 +1,34 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+#include "image_kernels.h"
+
+#define kernel struct
+#define param public
+#define local public
+#include "../blink/kernels/variance.blink"
+#undef kernel
+#undef param
+#undef local
+
+
+void runVariance(
+        ImageBuffer &src,
+        ImageBuffer &rowMeans,
+        ImageBuffer &rowSquaredDeviations,
+        const float2 &range,
+        const bool separable,
+        ImageBuffer &dst)
+{
+    Variance variance;
+    variance.define();
+    variance._range = range;
+    variance._separable = separable;
+    variance.src.bind(&src);
+    variance.rowMeans.bind(&rowMeans);
+    variance.rowSquaredDeviations.bind(&rowSquaredDeviations);
+    runKernel(variance, src, dst);
+}
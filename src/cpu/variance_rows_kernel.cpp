@@ -0,0 +1,30 @@
+// Copyright 2022 by Owen Bulka.
+// All rights reserved.
+// This file is released under the "MIT License Agreement".
+// Please see the LICENSE.md file that should have been included as part
+// of this package.
+
+#include "image_kernels.h"
+
+#define kernel struct
+#define param public
+#define local public
+#include "../blink/kernels/variance_rows.blink"
+#undef kernel
+#undef param
+#undef local
+
+
+void runVarianceRows(
+        ImageBuffer &src,
+        const float range,
+        const bool squaredDeviations,
+        ImageBuffer &dst)
+{
+    VarianceRows varianceRows;
+    varianceRows.define();
+    varianceRows._range = range;
+    varianceRows._squaredDeviations = squaredDeviations;
+    varianceRows.src.bind(&src);
+    runKernel(varianceRows, src, dst);
+}